@@ -0,0 +1,404 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include "includes/CaptureLog.h"
+#include "includes/RxTimeline.h"
+#include "includes/androidLog.h"
+
+CaptureChannel::CaptureChannel() :
+        on(false),
+        drops(0),
+        head(0),
+        tail(0) {
+}
+
+size_t CaptureChannel::recordSize(size_t len) {
+    return sizeof(Header) + ((len + 7) & ~static_cast<size_t>(7));
+}
+
+void CaptureChannel::push(int64_t time_ns, const char *data, size_t len) {
+    struct iovec piece = {const_cast<char *>(data), len};
+    push(time_ns, &piece, 1, len);
+}
+
+void CaptureChannel::push(int64_t time_ns, const struct iovec *iov, int count, size_t len) {
+    int index = 0;
+    size_t offset = 0;
+    while (len > 0) {
+        const size_t piece = len < MAX_RECORD_PAYLOAD ? len : MAX_RECORD_PAYLOAD;
+        const size_t size = recordSize(piece);
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (CAPACITY - (t - head.load(std::memory_order_acquire)) < size) {
+            //the rest of the write goes too, it would only tell half the story
+            drops.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        const Header header = {time_ns, static_cast<uint32_t>(piece), 0};
+        copyIn(t, &header, sizeof(header));
+        size_t pos = t + sizeof(header);
+        size_t left = piece;
+        while (left > 0 && index < count) {
+            const size_t step = std::min(left, iov[index].iov_len - offset);
+            copyIn(pos, static_cast<const char *>(iov[index].iov_base) + offset, step);
+            pos += step;
+            left -= step;
+            offset += step;
+            if (offset == iov[index].iov_len) {
+                index++;
+                offset = 0;
+            }
+        }
+        tail.store(t + size, std::memory_order_release);
+        len -= piece;
+    }
+}
+
+void CaptureChannel::enable() {
+    if (buffer == nullptr) {
+        //published to the producer by the release store below
+        buffer.reset(new char[CAPACITY]);
+    }
+    discard();
+    on.store(true, std::memory_order_release);
+}
+
+void CaptureChannel::disable() {
+    on.store(false, std::memory_order_release);
+}
+
+bool CaptureChannel::front(int64_t &time_ns, uint32_t &len) {
+    const size_t h = head.load(std::memory_order_relaxed);
+    if (buffer == nullptr || h == tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    Header header = {};
+    copyOut(h, &header, sizeof(header));
+    time_ns = header.time_ns;
+    len = header.length;
+    return true;
+}
+
+void CaptureChannel::read(char *dst, uint32_t len) {
+    copyOut(head.load(std::memory_order_relaxed) + sizeof(Header), dst, len);
+}
+
+void CaptureChannel::pop(uint32_t len) {
+    head.store(head.load(std::memory_order_relaxed) + recordSize(len), std::memory_order_release);
+}
+
+void CaptureChannel::discard() {
+    head.store(tail.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+uint64_t CaptureChannel::dropped() {
+    return drops.load(std::memory_order_relaxed);
+}
+
+void CaptureChannel::copyIn(size_t pos, const void *src, size_t len) {
+    const size_t offset = pos & (CAPACITY - 1);
+    const size_t first = std::min(len, CAPACITY - offset);
+    memcpy(buffer.get() + offset, src, first);
+    memcpy(buffer.get(), static_cast<const char *>(src) + first, len - first);
+}
+
+void CaptureChannel::copyOut(size_t pos, void *dst, size_t len) {
+    const size_t offset = pos & (CAPACITY - 1);
+    const size_t first = std::min(len, CAPACITY - offset);
+    memcpy(dst, buffer.get() + offset, first);
+    memcpy(static_cast<char *>(dst) + first, buffer.get(), len - first);
+}
+
+CaptureLog::CaptureLog() :
+        next_id(0),
+        active(false),
+        segment_bytes(0),
+        max_segments(0),
+        start_time_s(0),
+        sequence(0),
+        fd(-1),
+        map(nullptr),
+        used(0) {
+    stop_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop_event_fd < 0) {
+        std::__throw_runtime_error("创建eventfd失败!");
+    }
+}
+
+CaptureLog::~CaptureLog() {
+    stop();
+    close(stop_event_fd);
+    stop_event_fd = -1;
+}
+
+int CaptureLog::start(const std::string &directory, size_t bytes, int files,
+                      const std::string &selected_port) {
+    stop();
+    if (bytes < MIN_SEGMENT_BYTES || files < 1) {
+        return -EINVAL;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    dir = directory;
+    port = selected_port;
+    segment_bytes = bytes;
+    max_segments = files;
+    start_time_s = static_cast<int64_t>(time(nullptr));
+    sequence = 0;
+    //max_segments counts the files of this capture, earlier ones are left alone
+    segments.clear();
+    int error = openSegment();
+    if (error != 0) {
+        return error;
+    }
+    active = true;
+    for (auto &&entry : entries) {
+        if (selected(entry)) {
+            setCaptured(entry, true);
+            announce(entry);
+        }
+    }
+    thread = std::thread(&CaptureLog::run, this);
+    LOGD("开始抓包: %s, 每个文件%zu字节, 最多%d个", dir.c_str(), segment_bytes, max_segments);
+    return 0;
+}
+
+void CaptureLog::stop() {
+    if (thread.joinable()) {
+        eventfd_write(stop_event_fd, 1);
+        thread.join();
+        eventfd_t value;
+        eventfd_read(stop_event_fd, &value);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!active) {
+        return;
+    }
+    for (auto &&entry : entries) {
+        if (entry.captured) {
+            setCaptured(entry, false);
+            //whatever the ports staged after the last pass
+            drain(entry);
+        }
+    }
+    closeSegment();
+    active = false;
+    LOGD("停止抓包");
+}
+
+void CaptureLog::attach(const std::string &name, CaptureTap *tap) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.push_back({tap, name, next_id++, false, 0, 0});
+    Entry &entry = entries.back();
+    if (active && selected(entry)) {
+        setCaptured(entry, true);
+        announce(entry);
+    }
+}
+
+void CaptureLog::detach(CaptureTap *tap) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::find_if(entries.begin(), entries.end(),
+                           [tap](const Entry &entry) { return entry.tap == tap; });
+    if (it == entries.end()) {
+        return;
+    }
+    if (it->captured) {
+        setCaptured(*it, false);
+        drain(*it);
+    }
+    entries.erase(it);
+}
+
+bool CaptureLog::selected(const Entry &entry) {
+    return port.empty() || port == entry.name;
+}
+
+void CaptureLog::setCaptured(Entry &entry, bool captured) {
+    entry.captured = captured;
+    if (captured) {
+        entry.tap->rx.enable();
+        entry.tap->tx.enable();
+        entry.rx_dropped = entry.tap->rx.dropped();
+        entry.tx_dropped = entry.tap->tx.dropped();
+    } else {
+        entry.tap->rx.disable();
+        entry.tap->tx.disable();
+    }
+}
+
+void CaptureLog::run() {
+    struct pollfd pfd = {stop_event_fd, POLLIN, 0};
+    while (poll(&pfd, 1, DRAIN_INTERVAL_MS) <= 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        bool ok = true;
+        for (auto &&entry : entries) {
+            if (entry.captured && !drain(entry)) {
+                ok = false;
+                break;
+            }
+        }
+        if (map != nullptr) {
+            reinterpret_cast<CaptureFileHeader *>(map)->used = used;
+        }
+        if (!ok) {
+            LOGE("抓包文件写入失败, 停止抓包");
+            for (auto &&entry : entries) {
+                if (entry.captured)
+                    setCaptured(entry, false);
+            }
+            closeSegment();
+            active = false;
+            return;
+        }
+    }
+}
+
+bool CaptureLog::drain(Entry &entry) {
+    return drain(entry, entry.tap->rx, CAPTURE_RX, entry.rx_dropped) &&
+           drain(entry, entry.tap->tx, CAPTURE_TX, entry.tx_dropped);
+}
+
+bool CaptureLog::drain(Entry &entry, CaptureChannel &channel, CaptureRecordType type,
+                       uint64_t &reported) {
+    const uint64_t dropped = channel.dropped();
+    if (dropped != reported) {
+        char *payload = append(RxTimeline::now(), entry.id, CAPTURE_DROPPED, sizeof(uint32_t));
+        if (payload == nullptr) {
+            return false;
+        }
+        auto count = static_cast<uint32_t>(std::min<uint64_t>(dropped - reported, UINT32_MAX));
+        memcpy(payload, &count, sizeof(count));
+        reported = dropped;
+    }
+    int64_t time_ns;
+    uint32_t len;
+    while (channel.front(time_ns, len)) {
+        //copied from the staging buffer straight into the mapping
+        char *payload = append(time_ns, entry.id, type, len);
+        if (payload == nullptr) {
+            return false;
+        }
+        channel.read(payload, len);
+        channel.pop(len);
+    }
+    return true;
+}
+
+char *CaptureLog::reserve(uint32_t len) {
+    const size_t needed = sizeof(CaptureRecord) + ((len + 7u) & ~7u);
+    if (map != nullptr && used + needed <= segment_bytes) {
+        return map + used;
+    }
+    if (map != nullptr) {
+        closeSegment();
+        sequence++;
+    }
+    if (openSegment() != 0) {
+        return nullptr;
+    }
+    return used + needed <= segment_bytes ? map + used : nullptr;
+}
+
+char *CaptureLog::append(int64_t time_ns, uint16_t id, CaptureRecordType type, uint32_t len) {
+    char *at = reserve(len);
+    if (at == nullptr) {
+        return nullptr;
+    }
+    CaptureRecord record = {time_ns, id, type, 0, len};
+    memcpy(at, &record, sizeof(record));
+    //padding stays zero, the segment was preallocated
+    used += sizeof(CaptureRecord) + ((len + 7u) & ~7u);
+    return at + sizeof(CaptureRecord);
+}
+
+bool CaptureLog::announce(const Entry &entry) {
+    auto len = static_cast<uint32_t>(entry.name.size());
+    char *payload = append(RxTimeline::now(), entry.id, CAPTURE_PORT, len);
+    if (payload == nullptr) {
+        return false;
+    }
+    memcpy(payload, entry.name.data(), len);
+    return true;
+}
+
+int CaptureLog::openSegment() {
+    std::string path = dir + "/capture_" + std::to_string(start_time_s) + "_" +
+                       std::to_string(sequence) + ".mspcap";
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        int error = errno;
+        LOGE("创建抓包文件%s失败: %s", path.c_str(), strerror(error));
+        return -error;
+    }
+    //preallocated, so a full disk shows up here and not as SIGBUS on a store into the mapping
+    int error = ftruncate(fd, static_cast<off_t>(segment_bytes)) == 0 ? 0 : errno;
+    if (error == 0) {
+        error = posix_fallocate(fd, 0, static_cast<off_t>(segment_bytes));
+        if (error == EOPNOTSUPP || error == EINVAL) {
+            //filesystems without fallocate (vfat on sdcards), the sparse file has to do
+            error = 0;
+        }
+    }
+    void *mapped = MAP_FAILED;
+    if (error == 0) {
+        mapped = mmap(nullptr, segment_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED)
+            error = errno;
+    }
+    if (error != 0) {
+        LOGE("抓包文件%s分配失败: %s", path.c_str(), strerror(error));
+        close(fd);
+        fd = -1;
+        unlink(path.c_str());
+        return -error;
+    }
+    map = static_cast<char *>(mapped);
+    auto *header = reinterpret_cast<CaptureFileHeader *>(map);
+    memcpy(header->magic, "MSPCAP01", sizeof(header->magic));
+    header->version = 1;
+    header->header_size = sizeof(CaptureFileHeader);
+    header->sequence = sequence;
+    struct timespec realtime = {};
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    header->created_realtime_ns = static_cast<int64_t>(realtime.tv_sec) * 1000000000 +
+                                  realtime.tv_nsec;
+    header->created_raw_ns = RxTimeline::now();
+    used = sizeof(CaptureFileHeader);
+    header->used = used;
+    segments.push_back(path);
+    while (segments.size() > static_cast<size_t>(max_segments)) {
+        unlink(segments.front().c_str());
+        segments.pop_front();
+    }
+    //every segment names its ports, so it can be read on its own. Checked by selection, the
+    //last drains of stop() and detach() run with the ports no longer captured
+    for (auto &&entry : entries) {
+        if (active && selected(entry))
+            announce(entry);
+    }
+    return 0;
+}
+
+void CaptureLog::closeSegment() {
+    if (map == nullptr) {
+        return;
+    }
+    reinterpret_cast<CaptureFileHeader *>(map)->used = used;
+    munmap(map, segment_bytes);
+    map = nullptr;
+    //the unused preallocated tail is given back
+    if (ftruncate(fd, static_cast<off_t>(used)) != 0)
+        LOGE("抓包文件截断失败: %s", strerror(errno));
+    close(fd);
+    fd = -1;
+}
@@ -0,0 +1,333 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <cstring>
+#include "includes/Checksum.h"
+
+#if defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define CHECKSUM_ARM_CRC 1
+#elif defined(__x86_64__)
+#include <immintrin.h>
+#define CHECKSUM_X86 1
+#endif
+
+namespace {
+
+    struct CrcParams {
+        unsigned width;
+        //reflected CRCs keep the reflected polynomial
+        uint32_t poly;
+        uint32_t init;
+        uint32_t xorout;
+        bool reflected;
+    };
+
+    const CrcParams kParams[CHECKSUM_TYPE_COUNT] = {
+            {8,  0x07,       0x00,       0x00,       false},
+            {8,  0x8C,       0x00,       0x00,       true},
+            {16, 0xA001,     0xFFFF,     0x0000,     true},
+            {16, 0x1021,     0xFFFF,     0x0000,     false},
+            {16, 0x1021,     0x0000,     0x0000,     false},
+            {32, 0xEDB88320, 0xFFFFFFFF, 0xFFFFFFFF, true},
+            {32, 0x82F63B78, 0xFFFFFFFF, 0xFFFFFFFF, true},
+    };
+
+    //table[k][b] is the register after byte b followed by k zero bytes. Reflected registers sit
+    //in the low bits, the others are kept left aligned in 32 bits so every width shares one loop
+    struct SlicingTables {
+        uint32_t table[CHECKSUM_TYPE_COUNT][8][256];
+
+        SlicingTables() {
+            for (int type = 0; type < CHECKSUM_TYPE_COUNT; ++type) {
+                const CrcParams &p = kParams[type];
+                auto &t = table[type];
+                const uint32_t poly = p.reflected ? p.poly : p.poly << (32 - p.width);
+                for (uint32_t b = 0; b < 256; ++b) {
+                    uint32_t crc = p.reflected ? b : b << 24;
+                    for (int bit = 0; bit < 8; ++bit) {
+                        if (p.reflected) {
+                            crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+                        } else {
+                            crc = (crc & 0x80000000u) ? (crc << 1) ^ poly : crc << 1;
+                        }
+                    }
+                    t[0][b] = crc;
+                }
+                for (int k = 1; k < 8; ++k) {
+                    for (int b = 0; b < 256; ++b) {
+                        uint32_t prev = t[k - 1][b];
+                        t[k][b] = p.reflected ? (prev >> 8) ^ t[0][prev & 0xFF]
+                                              : (prev << 8) ^ t[0][prev >> 24];
+                    }
+                }
+            }
+        }
+    };
+
+    const SlicingTables kTables;
+
+    uint32_t Bytewise(const uint32_t (&t)[8][256], bool reflected, uint32_t crc,
+                      const uint8_t *p, size_t len) {
+        if (reflected) {
+            while (len--) {
+                crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+            }
+        } else {
+            while (len--) {
+                crc = (crc << 8) ^ t[0][(crc >> 24) ^ *p++];
+            }
+        }
+        return crc;
+    }
+
+    uint32_t SlicingBy8(const uint32_t (&t)[8][256], bool reflected, uint32_t crc,
+                        const uint8_t *p, size_t len) {
+        for (; len >= 8; p += 8, len -= 8) {
+            uint64_t x;
+            memcpy(&x, p, sizeof(x));
+            if (reflected) {
+                //the register overlaps the first bytes, lowest address first
+                x ^= crc;
+                crc = t[7][x & 0xFF] ^ t[6][(x >> 8) & 0xFF] ^
+                      t[5][(x >> 16) & 0xFF] ^ t[4][(x >> 24) & 0xFF] ^
+                      t[3][(x >> 32) & 0xFF] ^ t[2][(x >> 40) & 0xFF] ^
+                      t[1][(x >> 48) & 0xFF] ^ t[0][x >> 56];
+            } else {
+                x = __builtin_bswap64(x) ^ (static_cast<uint64_t>(crc) << 32);
+                crc = t[7][x >> 56] ^ t[6][(x >> 48) & 0xFF] ^
+                      t[5][(x >> 40) & 0xFF] ^ t[4][(x >> 32) & 0xFF] ^
+                      t[3][(x >> 24) & 0xFF] ^ t[2][(x >> 16) & 0xFF] ^
+                      t[1][(x >> 8) & 0xFF] ^ t[0][x & 0xFF];
+            }
+        }
+        return Bytewise(t, reflected, crc, p, len);
+    }
+
+#if CHECKSUM_ARM_CRC
+
+    bool HasCrcInstructions() {
+        static const bool crc = (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+        return crc;
+    }
+
+    __attribute__((target("crc")))
+    uint32_t Crc32Arm(uint32_t crc, const uint8_t *p, size_t len, bool castagnoli) {
+        for (; len >= 8; p += 8, len -= 8) {
+            uint64_t x;
+            memcpy(&x, p, sizeof(x));
+            crc = castagnoli ? __crc32cd(crc, x) : __crc32d(crc, x);
+        }
+        while (len--) {
+            crc = castagnoli ? __crc32cb(crc, *p++) : __crc32b(crc, *p++);
+        }
+        return crc;
+    }
+
+#elif CHECKSUM_X86
+
+    bool HasSse42() {
+        static const bool sse42 = __builtin_cpu_supports("sse4.2");
+        return sse42;
+    }
+
+    bool HasPclmul() {
+        static const bool pclmul = __builtin_cpu_supports("pclmul") &&
+                                   __builtin_cpu_supports("sse4.1");
+        return pclmul;
+    }
+
+    __attribute__((target("sse4.2")))
+    uint32_t Crc32cSse42(uint32_t crc, const uint8_t *p, size_t len) {
+        uint64_t crc64 = crc;
+        for (; len >= 8; p += 8, len -= 8) {
+            uint64_t x;
+            memcpy(&x, p, sizeof(x));
+            crc64 = _mm_crc32_u64(crc64, x);
+        }
+        crc = static_cast<uint32_t>(crc64);
+        while (len--) {
+            crc = _mm_crc32_u8(crc, *p++);
+        }
+        return crc;
+    }
+
+    //Folding with carry-less multiplication, after Intel's "Fast CRC Computation for Generic
+    //Polynomials Using PCLMULQDQ Instruction". len must be a multiple of 16 and at least 64
+    __attribute__((target("pclmul,sse4.1")))
+    uint32_t Crc32Pclmul(uint32_t crc, const uint8_t *p, size_t len) {
+        alignas(16) static const uint64_t k1k2[] = {0x0154442bd4, 0x01c6e41596};
+        alignas(16) static const uint64_t k3k4[] = {0x01751997d0, 0x00ccaa009e};
+        alignas(16) static const uint64_t k5k0[] = {0x0163cd6124, 0x0000000000};
+        alignas(16) static const uint64_t poly[] = {0x01db710641, 0x01f7011641};
+        __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+        x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x00));
+        x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x10));
+        x3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x20));
+        x4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x30));
+        x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+        x0 = _mm_load_si128(reinterpret_cast<const __m128i *>(k1k2));
+        p += 64;
+        len -= 64;
+
+        //four lanes of 16 bytes folded 64 bytes ahead
+        for (; len >= 64; p += 64, len -= 64) {
+            x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+            x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+            x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+            x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+            x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+            x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+                               _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x00)));
+            x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+                               _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x10)));
+            x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+                               _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x20)));
+            x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+                               _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 0x30)));
+        }
+
+        //fold the lanes into one
+        x0 = _mm_load_si128(reinterpret_cast<const __m128i *>(k3k4));
+        const __m128i lanes[] = {x2, x3, x4};
+        for (const __m128i &next : lanes) {
+            x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, next), x5);
+        }
+        for (; len >= 16; p += 16, len -= 16) {
+            x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128(reinterpret_cast<const __m128i *>(p))),
+                               x5);
+        }
+
+        //128 bits down to 64
+        x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+        x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+        x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+        x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(k5k0));
+        x2 = _mm_srli_si128(x1, 4);
+        x1 = _mm_and_si128(x1, x3);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_xor_si128(x1, x2);
+
+        //Barrett reduction to 32 bits
+        x0 = _mm_load_si128(reinterpret_cast<const __m128i *>(poly));
+        x2 = _mm_and_si128(x1, x3);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+        x2 = _mm_and_si128(x2, x3);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x1 = _mm_xor_si128(x1, x2);
+        return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+    }
+
+#endif
+
+    //the hardware kernel for type, null when this cpu has none
+    const char *HardwareKernel(ChecksumType type) {
+#if CHECKSUM_ARM_CRC
+        if ((type == CHECKSUM_CRC32 || type == CHECKSUM_CRC32C) && HasCrcInstructions()) {
+            return "armv8-crc";
+        }
+#elif CHECKSUM_X86
+        if (type == CHECKSUM_CRC32C && HasSse42()) {
+            return "sse4.2";
+        }
+        if (type == CHECKSUM_CRC32 && HasPclmul()) {
+            return "pclmul";
+        }
+#endif
+        return nullptr;
+    }
+
+    uint32_t Hardware(ChecksumType type, uint32_t crc, const uint8_t *p, size_t len) {
+#if CHECKSUM_ARM_CRC
+        return Crc32Arm(crc, p, len, type == CHECKSUM_CRC32C);
+#elif CHECKSUM_X86
+        if (type == CHECKSUM_CRC32C) {
+            return Crc32cSse42(crc, p, len);
+        }
+        size_t folded = len >= 64 ? len & ~static_cast<size_t>(15) : 0;
+        if (folded > 0) {
+            crc = Crc32Pclmul(crc, p, folded);
+        }
+        return SlicingBy8(kTables.table[type], true, crc, p + folded, len - folded);
+#else
+        return SlicingBy8(kTables.table[type], kParams[type].reflected, crc, p, len);
+#endif
+    }
+}
+
+bool ChecksumValidType(int type) {
+    return type >= 0 && type < CHECKSUM_TYPE_COUNT;
+}
+
+size_t ChecksumWidth(ChecksumType type) {
+    return kParams[type].width / 8;
+}
+
+uint32_t ChecksumInit(ChecksumType type) {
+    return kParams[type].init;
+}
+
+uint32_t ChecksumUpdate(ChecksumType type, uint32_t state, const void *data, size_t len,
+                        ChecksumKernel kernel) {
+    const CrcParams &p = kParams[type];
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    const auto &t = kTables.table[type];
+    //the loops keep narrow non-reflected registers left aligned
+    uint32_t crc = p.reflected ? state : state << (32 - p.width);
+    if (kernel == CHECKSUM_AUTO || kernel == CHECKSUM_HARDWARE) {
+        kernel = HardwareKernel(type) != nullptr ? CHECKSUM_HARDWARE : CHECKSUM_SLICING_BY_8;
+    }
+    switch (kernel) {
+        case CHECKSUM_BYTEWISE:
+            crc = Bytewise(t, p.reflected, crc, bytes, len);
+            break;
+        case CHECKSUM_HARDWARE:
+            crc = Hardware(type, crc, bytes, len);
+            break;
+        default:
+            crc = SlicingBy8(t, p.reflected, crc, bytes, len);
+            break;
+    }
+    return p.reflected ? crc : crc >> (32 - p.width);
+}
+
+uint32_t ChecksumFinal(ChecksumType type, uint32_t state) {
+    return state ^ kParams[type].xorout;
+}
+
+uint32_t Checksum(ChecksumType type, const void *data, size_t len) {
+    return ChecksumFinal(type, ChecksumUpdate(type, ChecksumInit(type), data, len));
+}
+
+const char *ChecksumKernelName(ChecksumType type) {
+    const char *hardware = HardwareKernel(type);
+    return hardware != nullptr ? hardware : "slicing-by-8";
+}
+
+bool ChecksumVerify(const ChecksumSpec &spec, const char *frame, size_t len) {
+    if (!ChecksumValidType(spec.type)) {
+        return true;
+    }
+    auto type = static_cast<ChecksumType>(spec.type);
+    const size_t width = ChecksumWidth(type);
+    if (len < spec.skip + width) {
+        return false;
+    }
+    const auto *trailer = reinterpret_cast<const uint8_t *>(frame + len - width);
+    uint32_t expected = 0;
+    for (size_t i = 0; i < width; ++i) {
+        expected |= static_cast<uint32_t>(trailer[spec.big_endian ? width - 1 - i : i]) << (8 * i);
+    }
+    return Checksum(type, frame + spec.skip, len - spec.skip - width) == expected;
+}
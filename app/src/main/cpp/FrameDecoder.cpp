@@ -0,0 +1,206 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <cstring>
+#include "includes/FrameDecoder.h"
+
+static constexpr char COBS_DELIMITER = 0x00;
+static constexpr char SLIP_END = static_cast<char>(0xC0);
+static constexpr char SLIP_ESC = static_cast<char>(0xDB);
+static constexpr char SLIP_ESC_END = static_cast<char>(0xDC);
+static constexpr char SLIP_ESC_ESC = static_cast<char>(0xDD);
+
+std::unique_ptr<FrameDecoder> FrameDecoder::create(const FrameDecoderSpec &spec, size_t max_frame) {
+    if (spec.checksum.type < 0) {
+        return createFraming(spec, max_frame);
+    }
+    if (!ChecksumValidType(spec.checksum.type) || spec.checksum.skip >= max_frame) {
+        return nullptr;
+    }
+    auto inner = createFraming(spec, max_frame);
+    if (inner == nullptr) {
+        return nullptr;
+    }
+    return std::unique_ptr<FrameDecoder>(new ChecksumDecoder(std::move(inner), spec.checksum));
+}
+
+std::unique_ptr<FrameDecoder> FrameDecoder::createFraming(const FrameDecoderSpec &spec,
+                                                          size_t max_frame) {
+    const auto &p = spec.params;
+    switch (spec.type) {
+        case FrameDecoderSpec::FIXED_LENGTH:
+            if (p.size() < 1 || p[0] <= 0 || static_cast<size_t>(p[0]) > max_frame) {
+                return nullptr;
+            }
+            return std::unique_ptr<FrameDecoder>(new FixedLengthDecoder(static_cast<size_t>(p[0])));
+        case FrameDecoderSpec::LENGTH_FIELD:
+            if (p.size() < 4 || p[0] < 0 || (p[1] != 1 && p[1] != 2 && p[1] != 4) ||
+                static_cast<size_t>(p[0] + p[1]) > max_frame) {
+                return nullptr;
+            }
+            return std::unique_ptr<FrameDecoder>(
+                    new LengthFieldDecoder(static_cast<size_t>(p[0]), static_cast<size_t>(p[1]),
+                                           p[2] != 0, p[3], max_frame));
+        case FrameDecoderSpec::DELIMITER:
+            if (spec.delimiter.empty() || spec.delimiter.size() >= max_frame) {
+                return nullptr;
+            }
+            return std::unique_ptr<FrameDecoder>(new DelimiterDecoder(spec.delimiter));
+        case FrameDecoderSpec::COBS:
+            return std::unique_ptr<FrameDecoder>(new CobsDecoder());
+        case FrameDecoderSpec::SLIP:
+            return std::unique_ptr<FrameDecoder>(new SlipDecoder());
+        default:
+            return nullptr;
+    }
+}
+
+FixedLengthDecoder::FixedLengthDecoder(size_t length) :
+        length(length) {
+}
+
+size_t FixedLengthDecoder::decode(char *data, size_t len, Frame &frame) {
+    if (len < length) {
+        return 0;
+    }
+    frame.data = data;
+    frame.size = length;
+    return length;
+}
+
+LengthFieldDecoder::LengthFieldDecoder(size_t offset, size_t width, bool big_endian,
+                                       int adjustment, size_t max_frame) :
+        offset(offset),
+        width(width),
+        big_endian(big_endian),
+        adjustment(adjustment),
+        max_frame(max_frame) {
+}
+
+size_t LengthFieldDecoder::decode(char *data, size_t len, Frame &frame) {
+    const size_t header = offset + width;
+    if (len < header) {
+        return 0;
+    }
+    const auto *field = reinterpret_cast<const uint8_t *>(data + offset);
+    uint64_t value = 0;
+    for (size_t i = 0; i < width; ++i) {
+        value |= static_cast<uint64_t>(field[big_endian ? i : width - 1 - i]) << (8 * (width - 1 - i));
+    }
+    const int64_t total = static_cast<int64_t>(header + value) + adjustment;
+    if (total < static_cast<int64_t>(header) || total > static_cast<int64_t>(max_frame)) {
+        //not a header we can trust, step one byte ahead and look again
+        frame = Frame();
+        return 1;
+    }
+    if (len < static_cast<size_t>(total)) {
+        return 0;
+    }
+    frame.data = data;
+    frame.size = static_cast<size_t>(total);
+    return frame.size;
+}
+
+DelimitedDecoder::DelimitedDecoder(std::vector<char> delimiter) :
+        delimiter(std::move(delimiter)),
+        scanned(0) {
+}
+
+size_t DelimitedDecoder::decode(char *data, size_t len, Frame &frame) {
+    const size_t dlen = delimiter.size();
+    //a delimiter may straddle the end of the previous scan
+    const size_t from = scanned >= dlen - 1 ? scanned - (dlen - 1) : 0;
+    if (len >= from + dlen) {
+        const void *end = dlen == 1 ? memchr(data + from, delimiter[0], len - from)
+                                    : memmem(data + from, len - from, delimiter.data(), dlen);
+        if (end != nullptr) {
+            const auto payload = static_cast<size_t>(static_cast<const char *>(end) - data);
+            scanned = 0;
+            //back to back delimiters make an empty frame, which is not junk
+            const long size = payload > 0 ? unescape(data, payload) : 0;
+            frame = Frame();
+            if (size >= 0) {
+                frame.data = data;
+                frame.size = static_cast<size_t>(size);
+            }
+            return payload + dlen;
+        }
+    }
+    scanned = len;
+    return 0;
+}
+
+void DelimitedDecoder::reset() {
+    scanned = 0;
+}
+
+DelimiterDecoder::DelimiterDecoder(std::vector<char> delimiter) :
+        DelimitedDecoder(std::move(delimiter)) {
+}
+
+CobsDecoder::CobsDecoder() :
+        DelimitedDecoder({COBS_DELIMITER}) {
+}
+
+long CobsDecoder::unescape(char *payload, size_t len) {
+    //the output never overtakes the input, so it is decoded in place
+    size_t r = 0, w = 0;
+    while (r < len) {
+        const auto code = static_cast<uint8_t>(payload[r++]);
+        const size_t run = code - 1u;
+        if (code == 0 || r + run > len) {
+            return -1;
+        }
+        memmove(payload + w, payload + r, run);
+        w += run;
+        r += run;
+        if (code != 0xFF && r < len) {
+            payload[w++] = 0;
+        }
+    }
+    return static_cast<long>(w);
+}
+
+SlipDecoder::SlipDecoder() :
+        DelimitedDecoder({SLIP_END}) {
+}
+
+long SlipDecoder::unescape(char *payload, size_t len) {
+    size_t w = 0;
+    for (size_t r = 0; r < len; ++r) {
+        char c = payload[r];
+        if (c == SLIP_ESC) {
+            if (++r == len) {
+                return -1;
+            }
+            if (payload[r] == SLIP_ESC_END) {
+                c = SLIP_END;
+            } else if (payload[r] == SLIP_ESC_ESC) {
+                c = SLIP_ESC;
+            } else {
+                return -1;
+            }
+        }
+        payload[w++] = c;
+    }
+    return static_cast<long>(w);
+}
+
+ChecksumDecoder::ChecksumDecoder(std::unique_ptr<FrameDecoder> inner, const ChecksumSpec &checksum) :
+        inner(std::move(inner)),
+        checksum(checksum) {
+}
+
+size_t ChecksumDecoder::decode(char *data, size_t len, Frame &frame) {
+    size_t n = inner->decode(data, len, frame);
+    if (n > 0 && frame.data != nullptr && frame.size > 0 &&
+        !ChecksumVerify(checksum, frame.data, frame.size)) {
+        frame = Frame();
+    }
+    return n;
+}
+
+void ChecksumDecoder::reset() {
+    inner->reset();
+}
@@ -0,0 +1,243 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <sys/timerfd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include "includes/FrameDispatcher.h"
+#include "includes/JniCache.h"
+
+FrameDispatcher::FrameDispatcher(jobject *callback, Mode mode, size_t batch_capacity) :
+        jcallback(callback),
+        mode(mode),
+        stats(nullptr),
+        region_base(nullptr),
+        region_size(0),
+        direct_buffer(nullptr),
+        timed(-1),
+        requested_max_frames(DEFAULT_BATCH_FRAMES),
+        requested_max_delay(DEFAULT_BATCH_DELAY_US),
+        max_frames(DEFAULT_BATCH_FRAMES),
+        max_delay(DEFAULT_BATCH_DELAY_US),
+        timer_fd(-1),
+        batch_used(0),
+        batch_count(0),
+        offsets_array(nullptr),
+        offsets_array_size(0),
+        times_array(nullptr) {
+    if (mode == BATCH) {
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer_fd < 0) {
+            std::__throw_runtime_error("创建timerfd失败!");
+        }
+        batch.resize(batch_capacity);
+        offsets.resize(DEFAULT_BATCH_FRAMES + 1);
+        region_base = batch.data();
+        region_size = batch.size();
+    }
+}
+
+FrameDispatcher::~FrameDispatcher() {
+    if (timer_fd >= 0)
+        close(timer_fd);
+    timer_fd = -1;
+}
+
+void FrameDispatcher::setDirectRegion(char *base, size_t size) {
+    //batch mode always points java at its own batch buffer
+    if (mode == DIRECT_BUFFER) {
+        region_base = base;
+        region_size = size;
+    }
+}
+
+void FrameDispatcher::setBatchLimits(int max_frames, useconds_t max_delay_us) {
+    requested_max_frames.store(max_frames > 0 ? max_frames : 1);
+    requested_max_delay.store(max_delay_us);
+}
+
+int FrameDispatcher::getTimerFd() {
+    return timer_fd;
+}
+
+bool FrameDispatcher::hasListener() {
+    return jcallback != nullptr && *jcallback != nullptr;
+}
+
+void FrameDispatcher::setStats(PortStats *portStats) {
+    stats = portStats;
+}
+
+void FrameDispatcher::recordCallback(int64_t start) {
+    if (stats != nullptr)
+        stats->record(PortStats::CALLBACK_TIME, static_cast<uint64_t>(PortStats::now() - start));
+}
+
+bool FrameDispatcher::isTimed(JNIEnv *env) {
+    if (timed < 0) {
+        jclass timedClass = mode == BATCH ? g_jni_cache.timedBatchReadListenerClass :
+                            mode == DIRECT_BUFFER ? g_jni_cache.timedDirectReadListenerClass :
+                            g_jni_cache.timedReadListenerClass;
+        timed = env->IsInstanceOf(*jcallback, timedClass) == JNI_TRUE ? 1 : 0;
+    }
+    return timed == 1;
+}
+
+void FrameDispatcher::deliver(JNIEnv *env, const char *frame, size_t len,
+                              const FrameTime &time) {
+    if (!hasListener() || env == nullptr || len == 0) {
+        return;
+    }
+    if (mode == BATCH) {
+        appendToBatch(env, frame, len, time);
+        return;
+    }
+    if (mode == DIRECT_BUFFER) {
+        ensureDirectBuffer(env);
+        auto offset = static_cast<jint>(frame - region_base);
+        const int64_t start = PortStats::now();
+        if (isTimed(env)) {
+            env->CallVoidMethod(*jcallback, g_jni_cache.onTimedDirectDataReceived, direct_buffer,
+                                offset, static_cast<jint>(len), time.first_read_ns,
+                                time.last_read_ns, time.first_byte_ns);
+        } else {
+            env->CallVoidMethod(*jcallback, g_jni_cache.onDirectDataReceived, direct_buffer,
+                                offset, static_cast<jint>(len));
+        }
+        recordCallback(start);
+        return;
+    }
+    //执行回调
+    jbyteArray arr = env->NewByteArray(static_cast<jsize>(len));
+    env->SetByteArrayRegion(arr, 0, static_cast<jsize>(len), (const jbyte *) frame);
+    const int64_t start = PortStats::now();
+    if (isTimed(env)) {
+        env->CallVoidMethod(*jcallback, g_jni_cache.onTimedDataReceived, arr,
+                            time.first_read_ns, time.last_read_ns, time.first_byte_ns);
+    } else {
+        env->CallVoidMethod(*jcallback, g_jni_cache.onDataReceived, arr);
+    }
+    recordCallback(start);
+    env->DeleteLocalRef(arr);
+}
+
+void FrameDispatcher::ensureDirectBuffer(JNIEnv *env) {
+    if (direct_buffer != nullptr) {
+        return;
+    }
+    jobject local = env->NewDirectByteBuffer(region_base, static_cast<jlong>(region_size));
+    if (local == nullptr) {
+        std::__throw_runtime_error("创建DirectByteBuffer失败!");
+    }
+    direct_buffer = env->NewGlobalRef(local);
+    env->DeleteLocalRef(local);
+}
+
+void FrameDispatcher::appendToBatch(JNIEnv *env, const char *frame, size_t len,
+                                    const FrameTime &time) {
+    if (batch_count > 0 && batch_used + len > batch.size()) {
+        flushBatch(env);
+    }
+    if (batch_count == 0) {
+        max_frames = requested_max_frames.load();
+        max_delay = requested_max_delay.load();
+        if (offsets.size() < static_cast<size_t>(max_frames) + 1) {
+            offsets.resize(max_frames + 1);
+        }
+        offsets[0] = 0;
+        if (isTimed(env) && times.size() < offsets.size() * 3) {
+            times.resize(offsets.size() * 3);
+        }
+    }
+    if (!times.empty()) {
+        jlong *slot = &times[batch_count * 3];
+        slot[0] = time.first_read_ns;
+        slot[1] = time.last_read_ns;
+        slot[2] = time.first_byte_ns;
+    }
+    //a frame is never larger than the receive ring, which the batch buffer matches
+    len = std::min(len, batch.size() - batch_used);
+    memcpy(batch.data() + batch_used, frame, len);
+    batch_used += len;
+    batch_count++;
+    offsets[batch_count] = static_cast<jint>(batch_used);
+    if (batch_count >= max_frames || max_delay == 0) {
+        flushBatch(env);
+    } else if (batch_count == 1) {
+        arm(max_delay);
+    }
+}
+
+void FrameDispatcher::onTimer(JNIEnv *env) {
+    uint64_t expirations = 0;
+    if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        return;
+    }
+    if (batch_count > 0 && hasListener() && env != nullptr) {
+        flushBatch(env);
+    }
+}
+
+void FrameDispatcher::flushBatch(JNIEnv *env) {
+    arm(0);
+    ensureDirectBuffer(env);
+    auto needed = static_cast<jsize>(offsets.size());
+    if (offsets_array == nullptr || offsets_array_size < needed) {
+        //only happens when the batch size grows
+        if (offsets_array != nullptr)
+            env->DeleteGlobalRef(offsets_array);
+        jintArray local = env->NewIntArray(needed);
+        offsets_array = static_cast<jintArray>(env->NewGlobalRef(local));
+        offsets_array_size = needed;
+        env->DeleteLocalRef(local);
+    }
+    env->SetIntArrayRegion(offsets_array, 0, batch_count + 1, offsets.data());
+    if (!times.empty() && (times_array == nullptr ||
+                           env->GetArrayLength(times_array) < static_cast<jsize>(times.size()))) {
+        if (times_array != nullptr)
+            env->DeleteGlobalRef(times_array);
+        jlongArray local = env->NewLongArray(static_cast<jsize>(times.size()));
+        times_array = static_cast<jlongArray>(env->NewGlobalRef(local));
+        env->DeleteLocalRef(local);
+    }
+    int count = batch_count;
+    batch_used = 0;
+    batch_count = 0;
+    const int64_t start = PortStats::now();
+    if (times_array != nullptr) {
+        env->SetLongArrayRegion(times_array, 0, count * 3, times.data());
+        env->CallVoidMethod(*jcallback, g_jni_cache.onTimedFramesReceived, direct_buffer,
+                            offsets_array, count, times_array);
+    } else {
+        env->CallVoidMethod(*jcallback, g_jni_cache.onFramesReceived, direct_buffer,
+                            offsets_array, count);
+    }
+    recordCallback(start);
+}
+
+void FrameDispatcher::arm(useconds_t us) {
+    struct itimerspec spec = {};
+    spec.it_value.tv_sec = us / 1000000;
+    spec.it_value.tv_nsec = static_cast<long>(us % 1000000) * 1000;
+    timerfd_settime(timer_fd, 0, &spec, nullptr);
+}
+
+void FrameDispatcher::release(JNIEnv *env) {
+    if (env != nullptr) {
+        if (direct_buffer != nullptr)
+            env->DeleteGlobalRef(direct_buffer);
+        if (offsets_array != nullptr)
+            env->DeleteGlobalRef(offsets_array);
+        if (times_array != nullptr)
+            env->DeleteGlobalRef(times_array);
+        if (jcallback)
+            env->DeleteGlobalRef(*jcallback);
+    }
+    direct_buffer = nullptr;
+    offsets_array = nullptr;
+    times_array = nullptr;
+    jcallback = nullptr;
+}
@@ -0,0 +1,168 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <cstdint>
+#include "includes/HexCodec.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HEX_CODEC_NEON 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HEX_CODEC_X86 1
+#endif
+
+namespace {
+
+    struct NibbleTable {
+        int8_t value[256];
+
+        NibbleTable() {
+            for (int i = 0; i < 256; ++i) {
+                value[i] = -1;
+            }
+            for (int i = 0; i < 10; ++i) {
+                value['0' + i] = static_cast<int8_t>(i);
+            }
+            for (int i = 0; i < 6; ++i) {
+                value['a' + i] = static_cast<int8_t>(10 + i);
+                value['A' + i] = static_cast<int8_t>(10 + i);
+            }
+        }
+    };
+
+    const NibbleTable kNibbles;
+
+#if HEX_CODEC_NEON
+
+    //32 hex characters -> 16 bytes, vld2q splits high and low nibble characters for us
+    bool DecodeNeon32(const char *hex, char *out) {
+        uint8x16x2_t pair = vld2q_u8(reinterpret_cast<const uint8_t *>(hex));
+        uint8x16_t nibbles[2];
+        uint8x16_t valid = vdupq_n_u8(0xFF);
+        for (int i = 0; i < 2; ++i) {
+            uint8x16_t digit = vsubq_u8(pair.val[i], vdupq_n_u8('0'));
+            uint8x16_t alpha = vsubq_u8(vorrq_u8(pair.val[i], vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+            uint8x16_t isDigit = vcleq_u8(digit, vdupq_n_u8(9));
+            uint8x16_t isAlpha = vcleq_u8(alpha, vdupq_n_u8(5));
+            nibbles[i] = vbslq_u8(isDigit, digit, vaddq_u8(alpha, vdupq_n_u8(10)));
+            valid = vandq_u8(valid, vorrq_u8(isDigit, isAlpha));
+        }
+        uint64x2_t lanes = vreinterpretq_u64_u8(valid);
+        if ((vgetq_lane_u64(lanes, 0) & vgetq_lane_u64(lanes, 1)) != UINT64_MAX) {
+            return false;
+        }
+        vst1q_u8(reinterpret_cast<uint8_t *>(out),
+                 vorrq_u8(vshlq_n_u8(nibbles[0], 4), nibbles[1]));
+        return true;
+    }
+
+#endif
+
+#if HEX_CODEC_X86
+
+    //16 hex characters -> 8 bytes, plain SSE2 so it runs on every x86 android device
+    bool DecodeSse16(const char *hex, char *out) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hex));
+        __m128i digit = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+        __m128i alpha = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+        __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+        __m128i isAlpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, _mm_set1_epi8(5)), alpha);
+        if (_mm_movemask_epi8(_mm_or_si128(isDigit, isAlpha)) != 0xFFFF) {
+            return false;
+        }
+        __m128i nibbles = _mm_or_si128(_mm_and_si128(isDigit, digit),
+                                       _mm_andnot_si128(isDigit,
+                                                        _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+        //even characters are the high nibble, odd ones the low nibble of each byte
+        __m128i high = _mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00FF)), 4);
+        __m128i low = _mm_srli_epi16(nibbles, 8);
+        __m128i bytes = _mm_packus_epi16(_mm_or_si128(high, low), _mm_setzero_si128());
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out), bytes);
+        return true;
+    }
+
+    //32 hex characters -> 16 bytes, only called after a runtime cpu check
+    __attribute__((target("avx2")))
+    bool DecodeAvx2_32(const char *hex, char *out) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hex));
+        __m256i digit = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+        __m256i alpha = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)),
+                                        _mm256_set1_epi8('a'));
+        __m256i isDigit = _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+        __m256i isAlpha = _mm256_cmpeq_epi8(_mm256_min_epu8(alpha, _mm256_set1_epi8(5)), alpha);
+        if (_mm256_movemask_epi8(_mm256_or_si256(isDigit, isAlpha)) != -1) {
+            return false;
+        }
+        __m256i nibbles = _mm256_blendv_epi8(_mm256_add_epi8(alpha, _mm256_set1_epi8(10)),
+                                             digit, isDigit);
+        __m256i merged = _mm256_maddubs_epi16(nibbles, _mm256_set1_epi16(0x0110));
+        //packus works per 128 bit lane, gather the two low quadwords afterwards
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(merged, merged), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm256_castsi256_si128(packed));
+        return true;
+    }
+
+    bool HasAvx2() {
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+        return avx2;
+    }
+
+#endif
+
+}
+
+bool HexToBytesScalar(const char *hex, size_t len, char *out) {
+    if (len % 2 != 0) {
+        return false;
+    }
+    const auto *in = reinterpret_cast<const uint8_t *>(hex);
+    for (size_t i = 0; i < len; i += 2) {
+        int high = kNibbles.value[in[i]];
+        int low = kNibbles.value[in[i + 1]];
+        if ((high | low) < 0) {
+            return false;
+        }
+        *out++ = static_cast<char>((high << 4) | low);
+    }
+    return true;
+}
+
+bool HexToBytes(const char *hex, size_t len, char *out) {
+    if (len % 2 != 0) {
+        return false;
+    }
+    size_t i = 0;
+#if HEX_CODEC_NEON
+    for (; i + 32 <= len; i += 32, out += 16) {
+        if (!DecodeNeon32(hex + i, out)) {
+            return false;
+        }
+    }
+#elif HEX_CODEC_X86
+    if (HasAvx2()) {
+        for (; i + 32 <= len; i += 32, out += 16) {
+            if (!DecodeAvx2_32(hex + i, out)) {
+                return false;
+            }
+        }
+    }
+    for (; i + 16 <= len; i += 16, out += 8) {
+        if (!DecodeSse16(hex + i, out)) {
+            return false;
+        }
+    }
+#endif
+    return HexToBytesScalar(hex + i, len - i, out);
+}
+
+const char *HexCodecKernel() {
+#if HEX_CODEC_NEON
+    return "neon";
+#elif HEX_CODEC_X86
+    return HasAvx2() ? "avx2" : "sse2";
+#else
+    return "scalar";
+#endif
+}
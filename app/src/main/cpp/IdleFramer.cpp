@@ -0,0 +1,78 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <sys/timerfd.h>
+#include <cstdint>
+#include <stdexcept>
+#include "includes/IdleFramer.h"
+
+IdleFramer::IdleFramer(useconds_t gap_us, size_t max_frame) :
+        timer_fd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+        gap(gap_us),
+        ring(max_frame) {
+    if (timer_fd < 0) {
+        std::__throw_runtime_error("创建timerfd失败!");
+    }
+}
+
+IdleFramer::~IdleFramer() {
+    close(timer_fd);
+    timer_fd = -1;
+}
+
+int IdleFramer::getTimerFd() {
+    return timer_fd;
+}
+
+void IdleFramer::setGap(useconds_t gap_us) {
+    gap.store(gap_us);
+}
+
+RingBuffer &IdleFramer::buffer() {
+    return ring;
+}
+
+bool IdleFramer::onData() {
+    if (ring.writable() == 0 || gap.load() == 0) {
+        return true;
+    }
+    arm(gap.load());
+    return false;
+}
+
+bool IdleFramer::expired() {
+    uint64_t expirations = 0;
+    //a stale expiration can still be queued after release() disarmed the timer
+    if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        return false;
+    }
+    return ring.readable() > 0;
+}
+
+char *IdleFramer::frame() {
+    return ring.readPtr();
+}
+
+size_t IdleFramer::frameSize() {
+    return ring.readable();
+}
+
+void IdleFramer::release() {
+    arm(0);
+    ring.consume(ring.readable());
+}
+
+void IdleFramer::consume(size_t n) {
+    ring.consume(n);
+    if (ring.readable() == 0) {
+        arm(0);
+    }
+}
+
+void IdleFramer::arm(useconds_t us) {
+    struct itimerspec spec = {};
+    spec.it_value.tv_sec = us / 1000000;
+    spec.it_value.tv_nsec = static_cast<long>(us % 1000000) * 1000;
+    timerfd_settime(timer_fd, 0, &spec, nullptr);
+}
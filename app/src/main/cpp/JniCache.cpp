@@ -0,0 +1,99 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include "includes/JniCache.h"
+#include "includes/androidLog.h"
+
+JniCache g_jni_cache = {};
+
+static jclass FindGlobalClass(JNIEnv *env, const char *name) {
+    jclass local = env->FindClass(name);
+    if (local == nullptr) {
+        LOGE("找不到java类%s", name);
+        return nullptr;
+    }
+    auto global = static_cast<jclass>(env->NewGlobalRef(local));
+    env->DeleteLocalRef(local);
+    return global;
+}
+
+bool InitJniCache(JNIEnv *env) {
+    g_jni_cache.readListenerClass =
+            FindGlobalClass(env, "com/castle/serialport/SerialPortManager$OnReadListener");
+    g_jni_cache.directReadListenerClass =
+            FindGlobalClass(env, "com/castle/serialport/SerialPortManager$OnDirectReadListener");
+    g_jni_cache.batchReadListenerClass =
+            FindGlobalClass(env, "com/castle/serialport/SerialPortManager$OnBatchReadListener");
+    g_jni_cache.timedReadListenerClass =
+            FindGlobalClass(env, "com/castle/serialport/SerialPortManager$OnTimedReadListener");
+    g_jni_cache.timedDirectReadListenerClass = FindGlobalClass(
+            env, "com/castle/serialport/SerialPortManager$OnTimedDirectReadListener");
+    g_jni_cache.timedBatchReadListenerClass = FindGlobalClass(
+            env, "com/castle/serialport/SerialPortManager$OnTimedBatchReadListener");
+    g_jni_cache.writeCompleteListenerClass =
+            FindGlobalClass(env, "com/castle/serialport/SerialPortManager$OnWriteCompleteListener");
+    g_jni_cache.transactionListenerClass =
+            FindGlobalClass(env, "com/castle/serialport/SerialPortManager$OnTransactionListener");
+    g_jni_cache.modbusPollListenerClass =
+            FindGlobalClass(env, "com/castle/serialport/SerialPortManager$OnModbusPollListener");
+    g_jni_cache.frameDecoderClass =
+            FindGlobalClass(env, "com/castle/serialport/SerialPortManager$FrameDecoder");
+    g_jni_cache.frameChecksumClass =
+            FindGlobalClass(env, "com/castle/serialport/SerialPortManager$FrameChecksum");
+    if (g_jni_cache.readListenerClass == nullptr ||
+        g_jni_cache.directReadListenerClass == nullptr ||
+        g_jni_cache.batchReadListenerClass == nullptr ||
+        g_jni_cache.timedReadListenerClass == nullptr ||
+        g_jni_cache.timedDirectReadListenerClass == nullptr ||
+        g_jni_cache.timedBatchReadListenerClass == nullptr ||
+        g_jni_cache.writeCompleteListenerClass == nullptr ||
+        g_jni_cache.transactionListenerClass == nullptr ||
+        g_jni_cache.modbusPollListenerClass == nullptr ||
+        g_jni_cache.frameDecoderClass == nullptr ||
+        g_jni_cache.frameChecksumClass == nullptr) {
+        return false;
+    }
+    g_jni_cache.onDataReceived = env->GetMethodID(g_jni_cache.readListenerClass,
+                                                  "onDataReceived", "([B)V");
+    g_jni_cache.onDirectDataReceived = env->GetMethodID(g_jni_cache.directReadListenerClass,
+                                                        "onDataReceived",
+                                                        "(Ljava/nio/ByteBuffer;II)V");
+    g_jni_cache.onFramesReceived = env->GetMethodID(g_jni_cache.batchReadListenerClass,
+                                                    "onFramesReceived",
+                                                    "(Ljava/nio/ByteBuffer;[II)V");
+    g_jni_cache.onTimedDataReceived = env->GetMethodID(g_jni_cache.timedReadListenerClass,
+                                                       "onDataReceived", "([BJJJ)V");
+    g_jni_cache.onTimedDirectDataReceived = env->GetMethodID(
+            g_jni_cache.timedDirectReadListenerClass, "onDataReceived",
+            "(Ljava/nio/ByteBuffer;IIJJJ)V");
+    g_jni_cache.onTimedFramesReceived = env->GetMethodID(g_jni_cache.timedBatchReadListenerClass,
+                                                         "onFramesReceived",
+                                                         "(Ljava/nio/ByteBuffer;[II[J)V");
+    g_jni_cache.onWriteComplete = env->GetMethodID(g_jni_cache.writeCompleteListenerClass,
+                                                   "onWriteComplete", "(JI)V");
+    g_jni_cache.onTransactionComplete = env->GetMethodID(g_jni_cache.transactionListenerClass,
+                                                         "onTransactionComplete", "(JI[B)V");
+    g_jni_cache.onPollCycle = env->GetMethodID(g_jni_cache.modbusPollListenerClass,
+                                               "onPollCycle", "(J[I[I[S)V");
+    g_jni_cache.frameDecoderType = env->GetFieldID(g_jni_cache.frameDecoderClass, "type", "I");
+    g_jni_cache.frameDecoderParams = env->GetFieldID(g_jni_cache.frameDecoderClass, "params", "[I");
+    g_jni_cache.frameDecoderDelimiter = env->GetFieldID(g_jni_cache.frameDecoderClass,
+                                                        "delimiter", "[B");
+    g_jni_cache.frameDecoderChecksum = env->GetFieldID(
+            g_jni_cache.frameDecoderClass, "checksum",
+            "Lcom/castle/serialport/SerialPortManager$FrameChecksum;");
+    g_jni_cache.frameChecksumType = env->GetFieldID(g_jni_cache.frameChecksumClass, "type", "I");
+    g_jni_cache.frameChecksumSkip = env->GetFieldID(g_jni_cache.frameChecksumClass, "skip", "I");
+    g_jni_cache.frameChecksumBigEndian = env->GetFieldID(g_jni_cache.frameChecksumClass,
+                                                         "bigEndian", "Z");
+    return g_jni_cache.onDataReceived != nullptr && g_jni_cache.onDirectDataReceived != nullptr &&
+           g_jni_cache.onFramesReceived != nullptr && g_jni_cache.onTimedDataReceived != nullptr &&
+           g_jni_cache.onTimedDirectDataReceived != nullptr &&
+           g_jni_cache.onTimedFramesReceived != nullptr && g_jni_cache.onWriteComplete != nullptr &&
+           g_jni_cache.onTransactionComplete != nullptr && g_jni_cache.onPollCycle != nullptr &&
+           g_jni_cache.frameDecoderType != nullptr && g_jni_cache.frameDecoderParams != nullptr &&
+           g_jni_cache.frameDecoderDelimiter != nullptr &&
+           g_jni_cache.frameDecoderChecksum != nullptr && g_jni_cache.frameChecksumType != nullptr &&
+           g_jni_cache.frameChecksumSkip != nullptr && g_jni_cache.frameChecksumBigEndian != nullptr;
+}
@@ -0,0 +1,151 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <stdexcept>
+#include "includes/ModbusPoller.h"
+
+ModbusPoller::ModbusPoller() :
+        timer_fd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+        changed(false),
+        next_period_ms(0),
+        next_timeout_ms(0),
+        next_baud(0),
+        period_ms(0),
+        timeout_ms(0),
+        timing(ModbusTimingFor(0)),
+        index(0),
+        awaiting(0),
+        cycle_start_ns(0),
+        gap_end_ns(0),
+        next_cycle_ns(0),
+        current() {
+    if (timer_fd < 0) {
+        std::__throw_runtime_error("创建timerfd失败!");
+    }
+}
+
+ModbusPoller::~ModbusPoller() {
+    close(timer_fd);
+    timer_fd = -1;
+}
+
+int ModbusPoller::getTimerFd() {
+    return timer_fd;
+}
+
+void ModbusPoller::setSchedule(std::vector<ModbusRead> newReads, uint32_t period,
+                               uint32_t timeout, int baud) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        next_reads = std::move(newReads);
+        next_period_ms = period;
+        next_timeout_ms = timeout;
+        next_baud = baud;
+        changed = true;
+    }
+    //onTimer() picks it up, and keeps the t3.5 gap if a request is still on the line
+    arm(1);
+}
+
+bool ModbusPoller::onTimer(std::vector<char> &request, ResponseMatcher &matcher,
+                           uint32_t &timeout) {
+    uint64_t expirations = 0;
+    if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations) ||
+        awaiting != 0) {
+        return false;
+    }
+    if (index == 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (changed) {
+            reads = std::move(next_reads);
+            period_ms = next_period_ms;
+            timeout_ms = next_timeout_ms;
+            timing = ModbusTimingFor(next_baud);
+            changed = false;
+            next_cycle_ns = 0;
+        }
+    }
+    if (reads.empty()) {
+        return false;
+    }
+    const int64_t start = now();
+    const int64_t due = std::max(gap_end_ns, index == 0 ? next_cycle_ns : 0);
+    if (start < due) {
+        arm(due - start);
+        return false;
+    }
+    if (index == 0) {
+        ++current.number;
+        current.status.assign(reads.size(), 0);
+        current.offsets.resize(reads.size() + 1);
+        current.offsets[0] = 0;
+        for (size_t i = 0; i < reads.size(); ++i) {
+            current.offsets[i + 1] = current.offsets[i] + reads[i].count;
+        }
+        current.values.assign(static_cast<size_t>(current.offsets.back()), 0);
+        cycle_start_ns = start;
+    }
+    const ModbusRead read = reads[index];
+    request = ModbusBuildRead(read);
+    matcher = ResponseMatcher::Predicate([read](const char *data, size_t len) {
+        return ModbusResponseSize(read, data, len);
+    });
+    timeout = timeout_ms;
+    return true;
+}
+
+void ModbusPoller::setTransaction(uint64_t id) {
+    awaiting = id;
+}
+
+bool ModbusPoller::owns(uint64_t id) {
+    return id != 0 && id == awaiting;
+}
+
+bool ModbusPoller::onResult(const TransactionEngine::Result &result) {
+    if (!owns(result.id)) {
+        return false;
+    }
+    awaiting = 0;
+    int status = result.status;
+    if (status == 0) {
+        status = ModbusParseRead(reads[index], result.response.data(), result.response.size(),
+                                 current.values.data() + current.offsets[index]);
+    }
+    current.status[index] = status;
+    const int64_t end = now();
+    gap_end_ns = end + static_cast<int64_t>(timing.t3_5_us) * 1000;
+    if (++index < reads.size()) {
+        arm(gap_end_ns - end);
+        return false;
+    }
+    index = 0;
+    next_cycle_ns = cycle_start_ns + static_cast<int64_t>(period_ms) * 1000000;
+    arm(std::max(gap_end_ns, next_cycle_ns) - end);
+    return true;
+}
+
+const ModbusPoller::Cycle &ModbusPoller::cycle() {
+    return current;
+}
+
+void ModbusPoller::arm(int64_t delay_ns) {
+    //an all zero it_value would disarm the timer
+    delay_ns = std::max<int64_t>(delay_ns, 1);
+    struct itimerspec spec = {};
+    spec.it_value.tv_sec = static_cast<time_t>(delay_ns / 1000000000);
+    spec.it_value.tv_nsec = static_cast<long>(delay_ns % 1000000000);
+    timerfd_settime(timer_fd, 0, &spec, nullptr);
+}
+
+int64_t ModbusPoller::now() {
+    struct timespec ts = {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
@@ -0,0 +1,123 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <cerrno>
+#include "includes/ModbusRtu.h"
+#include "includes/Checksum.h"
+
+namespace {
+
+    constexpr uint8_t EXCEPTION_BIT = 0x80;
+    //slave, function and CRC around the byte count and the data
+    constexpr size_t RESPONSE_OVERHEAD = 5;
+    constexpr size_t EXCEPTION_SIZE = 5;
+
+    bool IsBitRead(uint8_t function) {
+        return function == MODBUS_READ_COILS || function == MODBUS_READ_DISCRETE_INPUTS;
+    }
+
+    size_t DataBytes(const ModbusRead &read) {
+        return IsBitRead(read.function) ? (read.count + 7u) / 8u : read.count * 2u;
+    }
+}
+
+ModbusTiming ModbusTimingFor(int baud) {
+    if (baud <= 0 || baud > 19200) {
+        return {baud > 0 ? static_cast<uint32_t>(11000000ull / baud) : 0, 750, 1750};
+    }
+    auto char_us = static_cast<uint32_t>((11000000ull + baud - 1) / baud);
+    return {char_us, char_us * 3 / 2, char_us * 7 / 2};
+}
+
+uint16_t ModbusCrc16(const char *data, size_t len) {
+    return static_cast<uint16_t>(Checksum(CHECKSUM_CRC16_MODBUS, data, len));
+}
+
+bool ModbusValidRead(const ModbusRead &read) {
+    if (read.slave < 1 || read.slave > 247 || read.count == 0) {
+        return false;
+    }
+    switch (read.function) {
+        case MODBUS_READ_COILS:
+        case MODBUS_READ_DISCRETE_INPUTS:
+            return read.count <= 2000;
+        case MODBUS_READ_HOLDING_REGISTERS:
+        case MODBUS_READ_INPUT_REGISTERS:
+            return read.count <= 125;
+        default:
+            return false;
+    }
+}
+
+std::vector<char> ModbusBuildRead(const ModbusRead &read) {
+    std::vector<char> request = {
+            static_cast<char>(read.slave),
+            static_cast<char>(read.function),
+            static_cast<char>(read.address >> 8),
+            static_cast<char>(read.address & 0xFF),
+            static_cast<char>(read.count >> 8),
+            static_cast<char>(read.count & 0xFF),
+    };
+    uint16_t crc = ModbusCrc16(request.data(), request.size());
+    request.push_back(static_cast<char>(crc & 0xFF));
+    request.push_back(static_cast<char>(crc >> 8));
+    return request;
+}
+
+size_t ModbusResponseSize(const ModbusRead &read, const char *data, size_t len) {
+    if (len == 0) {
+        return 0;
+    }
+    if (static_cast<uint8_t>(data[0]) != read.slave) {
+        return len;
+    }
+    if (len < 2) {
+        return 0;
+    }
+    const auto function = static_cast<uint8_t>(data[1]);
+    if (function == (read.function | EXCEPTION_BIT)) {
+        return len >= EXCEPTION_SIZE ? EXCEPTION_SIZE : 0;
+    }
+    if (function != read.function) {
+        return len;
+    }
+    if (len < 3) {
+        return 0;
+    }
+    const size_t size = RESPONSE_OVERHEAD + static_cast<uint8_t>(data[2]);
+    return len >= size ? size : 0;
+}
+
+int ModbusParseRead(const ModbusRead &read, const char *data, size_t len, uint16_t *values) {
+    if (len < EXCEPTION_SIZE || static_cast<uint8_t>(data[0]) != read.slave) {
+        return -EBADMSG;
+    }
+    const uint16_t crc = static_cast<uint8_t>(data[len - 2]) |
+                         static_cast<uint16_t>(static_cast<uint8_t>(data[len - 1]) << 8);
+    if (ModbusCrc16(data, len - 2) != crc) {
+        return -EBADMSG;
+    }
+    const auto function = static_cast<uint8_t>(data[1]);
+    if (function == (read.function | EXCEPTION_BIT) && len == EXCEPTION_SIZE) {
+        //codes are 1..255, 0 would read as success
+        const auto code = static_cast<uint8_t>(data[2]);
+        return code != 0 ? code : -EBADMSG;
+    }
+    const size_t bytes = DataBytes(read);
+    if (function != read.function || static_cast<uint8_t>(data[2]) != bytes ||
+        len != RESPONSE_OVERHEAD + bytes) {
+        return -EBADMSG;
+    }
+    const auto *payload = reinterpret_cast<const uint8_t *>(data + 3);
+    if (IsBitRead(read.function)) {
+        for (size_t i = 0; i < read.count; ++i) {
+            values[i] = static_cast<uint16_t>((payload[i / 8] >> (i % 8)) & 1);
+        }
+    } else {
+        for (size_t i = 0; i < read.count; ++i) {
+            values[i] = static_cast<uint16_t>((payload[2 * i] << 8) | payload[2 * i + 1]);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <algorithm>
+#include "includes/PortStats.h"
+
+LatencyHistogram::LatencyHistogram() :
+        count(0),
+        sum(0),
+        max(0) {
+    for (auto &&b : buckets) {
+        b.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    const unsigned msb = 63u - static_cast<unsigned>(__builtin_clzll(value));
+    const unsigned shift = msb - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t LatencyHistogram::upperBound(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    const unsigned shift = static_cast<unsigned>(bucket / SUB_BUCKETS) - 1;
+    const uint64_t lower = static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t seen = max.load(std::memory_order_relaxed);
+    while (value > seen && !max.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    //buckets are copied first and the total taken from them, so percentiles stay consistent
+    //even while other threads keep recording
+    uint64_t copy[BUCKET_COUNT];
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        copy[i] = buckets[i].load(std::memory_order_relaxed);
+        total += copy[i];
+    }
+    Snapshot s = {};
+    s.count = total;
+    s.sum = sum.load(std::memory_order_relaxed);
+    s.max = max.load(std::memory_order_relaxed);
+    if (total == 0) {
+        return s;
+    }
+    const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    uint64_t *targets[] = {&s.p50, &s.p90, &s.p99, &s.p999};
+    size_t q = 0;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT && q < 4; ++i) {
+        seen += copy[i];
+        while (q < 4 && seen >= static_cast<uint64_t>(quantiles[q] * total + 0.5)) {
+            *targets[q++] = std::min(upperBound(i), s.max);
+        }
+    }
+    return s;
+}
+
+PortStats::PortStats() {
+    for (auto &&c : counters) {
+        c.value.store(0, std::memory_order_relaxed);
+    }
+}
+
+void PortStats::raise(Counter counter, uint64_t value) {
+    auto &c = counters[counter].value;
+    uint64_t seen = c.load(std::memory_order_relaxed);
+    while (value > seen && !c.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+PortStats::Snapshot PortStats::snapshot() const {
+    Snapshot s = {};
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        s.counters[i] = counters[i].value.load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < HISTOGRAM_COUNT; ++i) {
+        s.histograms[i] = histograms[i].snapshot();
+    }
+    return s;
+}
@@ -0,0 +1,138 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <new>
+#include "includes/RingBuffer.h"
+#include "includes/androidLog.h"
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+RingBuffer::RingBuffer(size_t capacity) :
+        mem(nullptr),
+        head(0),
+        tail(0),
+        consumed(0),
+        mirrored(false) {
+    auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    cap = (capacity + page - 1) / page * page;
+    if (cap == 0) {
+        cap = page;
+    }
+    if (!mapMirrored()) {
+        LOGD("memfd不可用, RingBuffer退化为普通缓冲区");
+        mem = new char[cap];
+    }
+}
+
+RingBuffer::~RingBuffer() {
+    if (mirrored) {
+        munmap(mem, cap * 2);
+    } else {
+        delete[] mem;
+    }
+    mem = nullptr;
+}
+
+bool RingBuffer::mapMirrored() {
+#ifdef __NR_memfd_create
+    //bionic only wraps memfd_create from api 30, go through the syscall directly
+    int fd = static_cast<int>(syscall(__NR_memfd_create, "mserialport_ring", MFD_CLOEXEC));
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(cap)) != 0) {
+        close(fd);
+        return false;
+    }
+    //reserve twice the size, then map the same file over both halves
+    void *area = mmap(nullptr, cap * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    auto base = static_cast<char *>(area);
+    void *first = mmap(base, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    void *second = mmap(base + cap, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    close(fd);
+    if (first == MAP_FAILED || second == MAP_FAILED) {
+        munmap(area, cap * 2);
+        return false;
+    }
+    mem = base;
+    mirrored = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+char *RingBuffer::writePtr() {
+    if (mirrored) {
+        return mem + tail % cap;
+    }
+    if (tail == cap && head > 0) {
+        //flat fallback, move the unread bytes back to the front
+        memmove(mem, mem + head, tail - head);
+        tail -= head;
+        head = 0;
+    }
+    return mem + tail;
+}
+
+size_t RingBuffer::writable() {
+    if (mirrored) {
+        return cap - (tail - head);
+    }
+    return cap - tail + (tail == cap ? head : 0);
+}
+
+void RingBuffer::commit(size_t n) {
+    tail += n;
+}
+
+char *RingBuffer::readPtr() {
+    return mirrored ? mem + head % cap : mem + head;
+}
+
+size_t RingBuffer::readable() {
+    return tail - head;
+}
+
+void RingBuffer::consume(size_t n) {
+    head += n;
+    consumed += n;
+    if (head == tail) {
+        //keep offsets small, and lets the flat fallback restart at the front
+        head = 0;
+        tail = 0;
+    }
+}
+
+void RingBuffer::clear() {
+    consumed += tail - head;
+    head = 0;
+    tail = 0;
+}
+
+uint64_t RingBuffer::position() {
+    return consumed;
+}
+
+size_t RingBuffer::capacity() {
+    return cap;
+}
+
+char *RingBuffer::base() {
+    return mem;
+}
+
+bool RingBuffer::isMirrored() {
+    return mirrored;
+}
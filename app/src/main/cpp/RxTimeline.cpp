@@ -0,0 +1,73 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <time.h>
+#include "includes/RxTimeline.h"
+
+RxTimeline::RxTimeline() :
+        marks(),
+        first(0),
+        count(0),
+        char_ns(0) {
+}
+
+int64_t RxTimeline::now() {
+    struct timespec ts = {};
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void RxTimeline::setCharTime(uint32_t ns) {
+    char_ns.store(ns);
+}
+
+bool RxTimeline::estimating() {
+    return char_ns.load(std::memory_order_relaxed) != 0;
+}
+
+void RxTimeline::onChunk(uint64_t end, size_t len, int64_t read_ns, size_t pending) {
+    Mark mark = {end - len, end, read_ns, 0};
+    const uint32_t ns = char_ns.load(std::memory_order_relaxed);
+    if (ns != 0) {
+        //the newest byte the driver holds has just arrived, everything before it came in
+        //back to back, which is what a frame on the wire looks like
+        mark.first_byte_ns = read_ns - static_cast<int64_t>(len + pending - 1) * ns;
+    }
+    if (count == MAX_MARKS) {
+        first = (first + 1) % MAX_MARKS;
+        count--;
+    }
+    marks[(first + count) % MAX_MARKS] = mark;
+    count++;
+}
+
+const RxTimeline::Mark &RxTimeline::at(size_t i) {
+    return marks[(first + i) % MAX_MARKS];
+}
+
+FrameTime RxTimeline::stamp(uint64_t start, size_t len) {
+    while (count > 0 && marks[first].end <= start) {
+        first = (first + 1) % MAX_MARKS;
+        count--;
+    }
+    FrameTime time;
+    if (count == 0) {
+        return time;
+    }
+    const Mark &head = at(0);
+    time.first_read_ns = head.read_ns;
+    if (head.first_byte_ns != 0) {
+        //the frame may start in the middle of the chunk
+        const uint64_t skipped = start > head.begin ? start - head.begin : 0;
+        time.first_byte_ns = head.first_byte_ns +
+                             static_cast<int64_t>(skipped) * char_ns.load(std::memory_order_relaxed);
+    }
+    const uint64_t end = start + len;
+    size_t i = 0;
+    while (i + 1 < count && at(i).end < end) {
+        i++;
+    }
+    time.last_read_ns = at(i).read_ns;
+    return time;
+}
@@ -2,80 +2,195 @@
 // Created by Administrator on 2019/11/25.
 //
 
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <cstring>
+#include <system_error>
 #include "includes/SPReadWriteWorker.h"
-
-static jbyteArray StringToJByteArray(JNIEnv *env, const std::string &nativeString) {
-    jbyteArray arr = env->NewByteArray(nativeString.length());
-    env->SetByteArrayRegion(arr, 0, nativeString.length(), (jbyte *) nativeString.c_str());
-    return arr;
-}
-
-const int BIT16 = 16;
-
-static void HexToBytes(const std::string &hex, char *result) {
-    for (unsigned int i = 0; i < hex.length(); i += 2) {
-        std::string byteString = hex.substr(i, 2);
-        char byte = (char) strtol(byteString.c_str(), nullptr, BIT16);
-        *result = byte;
-        result++;
-    }
-}
+#include "includes/HexCodec.h"
+#include "includes/JniCache.h"
 
 SPReadWriteWorker::SPReadWriteWorker(std::string &name, const int &baudrate, JavaVM *vm,
-                                     jobject *callback) :
-        jcallback(callback),
-        custom_read_interval(DEFAULT_TIME_INTERVAL),
+                                     jobject *callback, SerialPortReactor *reactor,
+                                     FrameDispatcher::Mode mode,
+                                     const FrameDecoderSpec &decoderSpec) :
+        stats(),
+        capture(),
+        framer(DEFAULT_TIME_INTERVAL, MAX_FRAME_SIZE),
+        decoder(FrameDecoder::create(decoderSpec, MAX_FRAME_SIZE)),
+        dispatcher(callback, mode, MAX_FRAME_SIZE),
+        stop_event_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
         read_thread(nullptr),
-        loop_thread(nullptr),
-        data_available(false),
+        write_thread(nullptr),
         g_vm(vm),
-        env(nullptr) {
-    _serialPort = new SerialPort(name, baudrate);
-//    _serialPort->SetTimeout(0);
+        env(nullptr),
+        _serialPort(new SerialPort(name, baudrate)),
+        reactor(reactor),
+        writer(_serialPort, WRITE_QUEUE_MAX_MESSAGES, WRITE_QUEUE_MAX_BYTES),
+        transactions([this](std::vector<char> &&request) {
+            //called on the read side too, which must never wait for the writer
+            return writer.tryEnqueue({std::move(request), WRITE_FIRE_AND_FORGET});
+        }),
+        modbus_listener(nullptr),
+        modbus_status(nullptr),
+        modbus_offsets(nullptr),
+        modbus_values(nullptr),
+        read_started(false),
+        reading(false),
+        write_blocked(false),
+        port_removed(false),
+        write_listener(nullptr),
+        write_env(nullptr) {
+    RingBuffer &ring = framer.buffer();
+    //a mirrored ring exposes every frame contiguously within twice its capacity
+    dispatcher.setDirectRegion(ring.base(),
+                               ring.isMirrored() ? ring.capacity() * 2 : ring.capacity());
+    if (reactor != nullptr) {
+        //the reactor thread must never block in read()
+        _serialPort->SetTimeout(0);
+    }
+    //neither read() nor write() may stall a loop that also serves the other direction
+    _serialPort->SetNonBlocking(true);
     _serialPort->Open();
     if (_serialPort->currendState() == State::OPEN) {
         LOGD("打开串口%s成功", name.c_str());
     } else {
         LOGD("打开串口%s失败", name.c_str());
     }
-    write_thread = new std::thread(&SPReadWriteWorker::writeLoop, this);
-
+    writer.setErrorHandler([](const WriteMessage &message, int error) {
+        LOGE("写入串口失败, 丢弃%zu字节(已写入%zu): %s", message.data.size(), message.written,
+             strerror(error));
+    });
+    writer.setCompletionHandler([this](uint64_t sequence, int error) {
+        notifyWriteComplete(sequence, error);
+    });
+    writer.setStats(&stats);
+    writer.setCapture(&capture.tx);
+    dispatcher.setStats(&stats);
+    if (reactor != nullptr) {
+        //one registration for both directions, the interest mask follows reading/write_blocked
+        reactor->add(_serialPort->getFileDescriptor(), 0,
+                     [this](uint32_t events) { onPortEvent(events); });
+        reactor->add(writer.getEventFd(), EPOLLIN,
+                     [this](uint32_t) { setWriteBlocked(writer.onEvent()); });
+        reactor->add(writer.getTimerFd(), EPOLLIN, [this](uint32_t) { writer.onTimer(); });
+    } else {
+        write_thread = new std::thread(&SPReadWriteWorker::writeLoop, this);
+    }
 }
 
 void SPReadWriteWorker::doWork(const std::vector<std::string> &msgs) {
+    doWork(msgs, WRITE_FIRE_AND_FORGET, 0);
+}
+
+int SPReadWriteWorker::doWork(const std::vector<std::string> &msgs, uint32_t flags,
+                              uint64_t key) {
     if (msgs[0] == START_READ) {
-        read_thread = new std::thread(&SPReadWriteWorker::readLoop, this);
-        loop_thread = new std::thread([&] {
-            struct pollfd fds[1] = {};
-            fds[0].fd = _serialPort->getFileDescriptor();
-            fds[0].events = POLLIN | POLLPRI;
-            int ret = 0;
-            int preCount = 0;
-            int readCount = 0;
-            while (!stopRequested()) {
-                ret = poll(fds, 1, custom_read_interval);
-                if (ret > 0 && (fds[0].revents & POLLIN)) {
-                    ioctl(_serialPort->getFileDescriptor(), FIONREAD, &readCount);
-                    if (preCount > 0 && (readCount == preCount)) {
-                        data_available.store(true);
-                        readCount = 0;
-                        preCount = 0;
-                        cv.notify_all();
-                    }
-                    preCount = readCount;
-                    usleep(custom_read_interval);
-                }
-            }
-            LOGD("Loop Thread end");
-        });
+        startReading();
+    } else if (msgs[0].find(SET_TRANSACTION_WINDOW) != std::string::npos) {
+        auto window = static_cast<size_t>(std::stoul(msgs[0].substr(strlen(SET_TRANSACTION_WINDOW))));
+        transactions.setWindow(window);
+        stats.add(PortStats::RECONFIGURATIONS);
+        LOGD("Set transaction window : %zu", window);
     } else if (msgs[0].find(SET_READ_INTERVAL) != std::string::npos) {
-        custom_read_interval = static_cast<useconds_t>(std::stoi(msgs[0].substr(14)));
-        LOGD("Set time interval : %d", custom_read_interval);
+        auto interval = static_cast<useconds_t>(std::stoi(msgs[0].substr(14)));
+        framer.setGap(interval);
+        stats.add(PortStats::RECONFIGURATIONS);
+        LOGD("Set time interval : %d", interval);
+    } else if (msgs[0].find(SET_READ_BUFFER_SIZE) != std::string::npos) {
+        size_t size = 0;
+        try {
+            size = static_cast<size_t>(std::stoul(msgs[0].substr(strlen(SET_READ_BUFFER_SIZE))));
+            _serialPort->SetReadBufferSize(size);
+        } catch (const std::exception &e) {
+            LOGE("设置读缓冲区大小失败: %s", e.what());
+            return -EINVAL;
+        }
+        stats.add(PortStats::RECONFIGURATIONS);
+        LOGD("Set read buffer size : %zu", size);
+    } else if (msgs[0].find(SET_LOW_LATENCY) != std::string::npos) {
+        bool enabled = std::stoi(msgs[0].substr(strlen(SET_LOW_LATENCY))) != 0;
+        _serialPort->SetLowLatency(enabled);
+        stats.add(PortStats::RECONFIGURATIONS);
+        LOGD("Set low latency : %d", enabled ? 1 : 0);
+    } else if (msgs[0].find(SET_WRITE_QUEUE) != std::string::npos) {
+        auto params = msgs[0].substr(strlen(SET_WRITE_QUEUE));
+        auto first = params.find(',');
+        auto second = params.find(',', first + 1);
+        auto maxMessages = static_cast<size_t>(std::stoul(params.substr(0, first)));
+        auto maxBytes = static_cast<size_t>(std::stoul(params.substr(first + 1, second - first - 1)));
+        auto policy = static_cast<QueuePolicy>(std::stoi(params.substr(second + 1)));
+        writer.setQueueLimits(maxMessages, maxBytes, policy);
+        stats.add(PortStats::RECONFIGURATIONS);
+        LOGD("Set write queue : %zu messages, %zu bytes, policy %d", maxMessages, maxBytes, policy);
+    } else if (msgs[0].find(SET_WRITE_CHUNK) != std::string::npos) {
+        auto size = static_cast<size_t>(std::stoul(msgs[0].substr(strlen(SET_WRITE_CHUNK))));
+        writer.setChunkSize(size);
+        stats.add(PortStats::RECONFIGURATIONS);
+        LOGD("Set write chunk size : %zu", size);
+    } else if (msgs[0].find(SET_FIRST_BYTE_ESTIMATE) != std::string::npos) {
+        bool enabled = std::stoi(msgs[0].substr(strlen(SET_FIRST_BYTE_ESTIMATE))) != 0;
+        //character time at the rate and framing the driver really runs at
+        int baud = _serialPort->GetActualBaudRate();
+        uint32_t charNs = 0;
+        if (enabled && baud > 0) {
+            charNs = static_cast<uint32_t>(_serialPort->CharacterBits() * 1000000000ull / baud);
+        }
+        timeline.setCharTime(charNs);
+        stats.add(PortStats::RECONFIGURATIONS);
+        LOGD("Set first byte estimate : %u ns per character", charNs);
+    } else if (msgs[0] == FLUSH) {
+        return writer.enqueue({std::vector<char>(), WRITE_DRAIN_AFTER});
+    } else if (msgs[0].find(SET_BATCH_DELIVERY) != std::string::npos) {
+        auto params = msgs[0].substr(strlen(SET_BATCH_DELIVERY));
+        auto comma = params.find(',');
+        int maxFrames = std::stoi(params.substr(0, comma));
+        auto maxDelay = static_cast<useconds_t>(std::stoi(params.substr(comma + 1)));
+        dispatcher.setBatchLimits(maxFrames, maxDelay);
+        stats.add(PortStats::RECONFIGURATIONS);
+        LOGD("Set batch delivery : %d frames, %d us", maxFrames, maxDelay);
     } else {
-        const std::lock_guard<std::mutex> lock(m_mutex);
-        mMessages.push(msgs);
-        cv.notify_all();
+        int error = 0;
+        for (auto &&c:msgs) {
+            WriteMessage message = {writer.acquireBuffer(), flags};
+            message.data.resize(c.length() / 2);
+            //odd lengths are refused by HexToBytes as well
+            if (!HexToBytes(c.data(), c.length(), message.data.data())) {
+                LOGE("非法的16进制字符串: %s", c.c_str());
+                if (error == 0)
+                    error = -EINVAL;
+                continue;
+            }
+            message.key = key;
+            int result = writer.enqueue(std::move(message));
+            if (error == 0)
+                error = result;
+        }
+        return error;
+    }
+    return 0;
+}
+
+void SPReadWriteWorker::startReading() {
+    if (read_started.exchange(true)) {
+        return;
+    }
+    if (reactor == nullptr) {
+        read_thread = new std::thread(&SPReadWriteWorker::readLoop, this);
+        return;
+    }
+    reactor->add(framer.getTimerFd(), EPOLLIN,
+                 [this](uint32_t) { onIdleTimeout(reactor->getEnv()); });
+    if (dispatcher.getTimerFd() >= 0) {
+        reactor->add(dispatcher.getTimerFd(), EPOLLIN,
+                     [this](uint32_t) { onBatchTimeout(reactor->getEnv()); });
     }
+    reactor->add(transactions.getTimerFd(), EPOLLIN,
+                 [this](uint32_t) { onTransactionTimeout(reactor->getEnv()); });
+    reactor->add(modbus.getTimerFd(), EPOLLIN, [this](uint32_t) { onModbusTimer(); });
+    std::lock_guard<std::mutex> lock(interest_mutex);
+    reading = true;
+    updateInterest();
 }
 
 void SPReadWriteWorker::readLoop() {
@@ -86,109 +201,521 @@ void SPReadWriteWorker::readLoop() {
             std::__throw_runtime_error("获取java虚拟机实例失败!");
         }
     }
-    //通过强转后的jcallback 获取到要回调的类
-    //这行会报deleted
-    jclass javaClass = env->GetObjectClass(*jcallback);
+    struct pollfd fds[6] = {};
+    fds[0].fd = _serialPort->getFileDescriptor();
+    fds[0].events = POLLIN;
+    fds[1].fd = framer.getTimerFd();
+    fds[1].events = POLLIN;
+    fds[2].fd = stop_event_fd;
+    fds[2].events = POLLIN;
+    //negative unless batching, poll skips it then
+    fds[3].fd = dispatcher.getTimerFd();
+    fds[3].events = POLLIN;
+    fds[4].fd = transactions.getTimerFd();
+    fds[4].events = POLLIN;
+    fds[5].fd = modbus.getTimerFd();
+    fds[5].events = POLLIN;
+    //开始循环, 数据到达时读取并重置空闲计时器, 计时器到期即为一帧
+    while (!stopRequested()) {
+        if (poll(fds, 6, -1) <= 0) {
+            continue;
+        }
+        if (stopRequested()) {
+            break;
+        }
+        if (fds[4].revents & POLLIN) {
+            onTransactionTimeout(env);
+        }
+        //POLLHUP and POLLERR come without POLLIN once the device is gone and poll reports them
+        //again right away, leftovers are still read while POLLIN is set
+        bool hangup = (fds[0].revents & (POLLHUP | POLLERR)) != 0;
+        if (fds[0].revents & POLLIN) {
+            hangup = !onReadable(env);
+        }
+        if (hangup) {
+            onHangup(env);
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            onIdleTimeout(env);
+        }
+        if (fds[3].revents & POLLIN) {
+            onBatchTimeout(env);
+        }
+        if (fds[5].revents & POLLIN) {
+            onModbusTimer();
+        }
+    }
+    LOGD("读线程终止运行");
+    dispatcher.release(env);
+    if (g_vm)
+        g_vm->DetachCurrentThread();
+}
 
-    if (javaClass == 0) {
-        std::__throw_runtime_error("获取java回调类失败!");
+bool SPReadWriteWorker::onReadable(JNIEnv *callEnv) {
+    //one read per wakeup, in reactor mode epoll is level triggered so leftovers
+    //fire again without starving the other ports
+    if (framer.buffer().writable() == 0) {
+        if (decoder != nullptr) {
+            //a full ring and still no complete frame, nothing in it will ever decode
+            stats.add(PortStats::DROPPED_FRAMES);
+            framer.release();
+            decoder->reset();
+        } else {
+            //frame reached the ring capacity without a gap, hand it out to make room
+            emitFrame(callEnv);
+        }
+    }
+    RingBuffer &ring = framer.buffer();
+    const int64_t start = PortStats::now();
+    size_t n;
+    bool hangup = false;
+    try {
+        n = _serialPort->ReadInto(ring, &hangup);
+    } catch (const std::system_error &e) {
+        LOGE("读取串口失败: %s", e.what());
+        return false;
+    }
+    //taken before anything else, so loop and JNI delays never skew it
+    const int64_t read_ns = RxTimeline::now();
+    stats.record(PortStats::SYSCALL_TIME, static_cast<uint64_t>(PortStats::now() - start));
+    stats.add(PortStats::READ_CALLS);
+    if (n == 0) {
+        return !hangup;
+    }
+    size_t pending = 0;
+    if (timeline.estimating()) {
+        int queued = _serialPort->InputPending();
+        pending = queued > 0 ? static_cast<size_t>(queued) : 0;
+    }
+    timeline.onChunk(ring.position() + ring.readable(), n, read_ns, pending);
+    if (capture.rx.enabled()) {
+        //the chunk just read is the contiguous end of the readable bytes
+        capture.rx.push(read_ns, ring.readPtr() + ring.readable() - n, n);
+    }
+    stats.add(PortStats::BYTES_IN, n);
+    if (matchResponses(callEnv)) {
+        //no idle framing while a response is expected, the deadline covers a silent device
+        return true;
+    }
+    if (decoder != nullptr) {
+        decodeFrames(callEnv);
+        return true;
     }
+    if (framer.onData()) {
+        emitFrame(callEnv);
+    }
+    return true;
+}
 
-    //获取要回调的方法ID
-    jmethodID javaCallbackId = env->GetMethodID(javaClass,
-                                                "onDataReceived", "([B)V");
-    if (javaCallbackId == nullptr) {
-        std::__throw_runtime_error("获取java回调方法失败!");
+void SPReadWriteWorker::onHangup(JNIEnv *callEnv) {
+    LOGE("串口已断开, 停止读写(fd %d)", _serialPort->getFileDescriptor());
+    //the frame that was coming in when the line went away
+    if (framer.frameSize() > 0 && !transactions.inFlight() && decoder == nullptr) {
+        emitFrame(callEnv);
     }
+    //queued and later writes fail with EPIPE instead of waiting for a port that is gone,
+    //the reactor thread is the writer side, a write thread does it on the event close() sends
+    if (reactor != nullptr) {
+        writer.stop();
+    } else {
+        writer.close();
+    }
+    transactions.cancelAll(results);
+    deliverResults(callEnv);
+}
 
-    std::string data;
-    std::unique_lock<std::mutex> lk(m_mutex);
-    //开始循环
-    while (true) {
-        cv.wait(lk, [&] {
-            return stopRequested() || data_available.load();
-        });
-        if (stopRequested()) {
+void SPReadWriteWorker::onPortEvent(uint32_t events) {
+    if (events & EPOLLOUT) {
+        setWriteBlocked(writer.onWritable());
+    }
+    //EPOLLHUP and EPOLLERR are reported whatever the interest, a write only port included,
+    //leftovers are still read while EPOLLIN is set
+    bool hangup = (events & (EPOLLERR | EPOLLHUP)) != 0;
+    if ((events & EPOLLIN) && reading) {
+        hangup = !onReadable(reactor->getEnv());
+    }
+    if (!hangup) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(interest_mutex);
+        if (port_removed) {
+            return;
+        }
+        //clearing the interest would not stop them, only removing the fd does.
+        //Safe from within its own handler, the reactor looks handlers up per event
+        port_removed = true;
+        reading = false;
+        reactor->remove(_serialPort->getFileDescriptor());
+    }
+    onHangup(reactor->getEnv());
+}
+
+void SPReadWriteWorker::setWriteBlocked(bool blocked) {
+    std::lock_guard<std::mutex> lock(interest_mutex);
+    if (write_blocked != blocked) {
+        write_blocked = blocked;
+        updateInterest();
+    }
+}
+
+void SPReadWriteWorker::updateInterest() {
+    //modify() takes no reactor lock, so this is safe from java threads and the reactor alike
+    if (port_removed) {
+        return;
+    }
+    uint32_t events = (reading ? EPOLLIN : 0u) | (write_blocked ? EPOLLOUT : 0u);
+    reactor->modify(_serialPort->getFileDescriptor(), events);
+}
+
+void SPReadWriteWorker::notifyWriteComplete(uint64_t sequence, int error) {
+    std::lock_guard<std::mutex> lock(listener_mutex);
+    JNIEnv *callEnv = reactor != nullptr ? reactor->getEnv() : write_env;
+    if (write_listener == nullptr || callEnv == nullptr) {
+        return;
+    }
+    const int64_t start = PortStats::now();
+    callEnv->CallVoidMethod(write_listener, g_jni_cache.onWriteComplete,
+                            static_cast<jlong>(sequence), static_cast<jint>(error));
+    stats.record(PortStats::CALLBACK_TIME, static_cast<uint64_t>(PortStats::now() - start));
+}
+
+void SPReadWriteWorker::setWriteListener(JNIEnv *callEnv, jobject listener) {
+    std::lock_guard<std::mutex> lock(listener_mutex);
+    if (write_listener != nullptr)
+        callEnv->DeleteGlobalRef(write_listener);
+    write_listener = listener != nullptr ? callEnv->NewGlobalRef(listener) : nullptr;
+}
+
+int SPReadWriteWorker::getActualBaudRate() {
+    return _serialPort->GetActualBaudRate();
+}
+
+LatencySettings SPReadWriteWorker::getLatencySettings() {
+    return _serialPort->GetLatencySettings();
+}
+
+bool SPReadWriteWorker::getStats(PortStats::Snapshot &snapshot) {
+    snapshot = stats.snapshot();
+    return true;
+}
+
+CaptureTap *SPReadWriteWorker::getCaptureTap() {
+    return &capture;
+}
+
+void SPReadWriteWorker::onIdleTimeout(JNIEnv *callEnv) {
+    if (framer.expired() && !transactions.inFlight() && decoder == nullptr) {
+        emitFrame(callEnv);
+    }
+}
+
+bool SPReadWriteWorker::matchResponses(JNIEnv *callEnv) {
+    if (!transactions.inFlight()) {
+        return false;
+    }
+    //pipelined responses may arrive in the same chunk
+    while (framer.frameSize() > 0) {
+        size_t n = transactions.onData(framer.frame(), framer.frameSize(), results);
+        if (n == 0) {
             break;
         }
-        _serialPort->Read(data);
-//        mBuffer.insert(mbu)
-        data_available.store(false);
-        //执行回调
-        auto jArr = StringToJByteArray(env, data);
-        env->CallVoidMethod(*jcallback, javaCallbackId, jArr);
-        env->DeleteLocalRef(jArr);
+        framer.consume(n);
+        //the decoder's scan position no longer matches the ring
+        if (decoder != nullptr)
+            decoder->reset();
     }
-    LOGD("读线程终止运行");
-    if (jcallback)
-        env->DeleteGlobalRef(*jcallback);
-    if (g_vm)
-        g_vm->DetachCurrentThread();
+    deliverResults(callEnv);
+    //whatever is left once nothing is expected goes to the read listener as usual
+    return transactions.inFlight();
+}
+
+void SPReadWriteWorker::onTransactionTimeout(JNIEnv *callEnv) {
+    transactions.onTimer(results);
+    if (!results.empty() && !transactions.inFlight()) {
+        //a late or partial response must not be taken for the next one
+        if (framer.frameSize() > 0)
+            stats.add(PortStats::DROPPED_FRAMES);
+        framer.release();
+        if (decoder != nullptr)
+            decoder->reset();
+    }
+    deliverResults(callEnv);
+}
+
+void SPReadWriteWorker::deliverResults(JNIEnv *callEnv) {
+    for (auto &&r : results) {
+        if (modbus.owns(r.id)) {
+            if (r.status == 0)
+                stats.add(PortStats::FRAMES_IN);
+            if (modbus.onResult(r))
+                deliverModbusCycle(callEnv);
+            continue;
+        }
+        jobject listener = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(transaction_mutex);
+            auto it = transaction_listeners.find(r.id);
+            if (it != transaction_listeners.end()) {
+                listener = it->second;
+                transaction_listeners.erase(it);
+            }
+        }
+        if (listener == nullptr || callEnv == nullptr) {
+            continue;
+        }
+        jbyteArray response = nullptr;
+        if (r.status == 0) {
+            stats.add(PortStats::FRAMES_IN);
+            auto len = static_cast<jsize>(r.response.size());
+            response = callEnv->NewByteArray(len);
+            callEnv->SetByteArrayRegion(response, 0, len,
+                                        reinterpret_cast<const jbyte *>(r.response.data()));
+        }
+        const int64_t start = PortStats::now();
+        callEnv->CallVoidMethod(listener, g_jni_cache.onTransactionComplete,
+                                static_cast<jlong>(r.id), static_cast<jint>(r.status), response);
+        stats.record(PortStats::CALLBACK_TIME, static_cast<uint64_t>(PortStats::now() - start));
+        if (response != nullptr)
+            callEnv->DeleteLocalRef(response);
+        callEnv->DeleteGlobalRef(listener);
+    }
+    results.clear();
+}
+
+int64_t SPReadWriteWorker::submitTransaction(JNIEnv *callEnv, std::vector<char> &&request,
+                                             ResponseMatcher &&matcher, uint32_t timeout_ms,
+                                             jobject listener) {
+    //write-only ports start reading on their first transaction
+    startReading();
+    std::lock_guard<std::mutex> lock(transaction_mutex);
+    uint64_t id = transactions.submit(std::move(request), std::move(matcher), timeout_ms);
+    transaction_listeners[id] = callEnv->NewGlobalRef(listener);
+    return static_cast<int64_t>(id);
+}
+
+int SPReadWriteWorker::startModbusPolling(JNIEnv *callEnv, std::vector<ModbusRead> &&reads,
+                                          uint32_t period_ms, uint32_t timeout_ms,
+                                          jobject listener) {
+    {
+        std::lock_guard<std::mutex> lock(modbus_mutex);
+        if (modbus_listener != nullptr)
+            callEnv->DeleteGlobalRef(modbus_listener);
+        modbus_listener = listener != nullptr ? callEnv->NewGlobalRef(listener) : nullptr;
+    }
+    if (!reads.empty()) {
+        startReading();
+    }
+    //the gaps follow the rate the driver really runs at
+    modbus.setSchedule(std::move(reads), period_ms, timeout_ms, _serialPort->GetActualBaudRate());
+    stats.add(PortStats::RECONFIGURATIONS);
+    return 0;
+}
+
+void SPReadWriteWorker::onModbusTimer() {
+    std::vector<char> request;
+    ResponseMatcher matcher;
+    uint32_t timeout_ms = 0;
+    if (modbus.onTimer(request, matcher, timeout_ms)) {
+        //submitted from the read side, so no result can come back before the id is set.
+        //The request never waits for room in the write queue, a full one fails this read
+        //with -EAGAIN on the next transaction timer and the cycle goes on with the next read
+        modbus.setTransaction(transactions.submit(std::move(request), std::move(matcher),
+                                                  timeout_ms));
+    }
+}
+
+void SPReadWriteWorker::deliverModbusCycle(JNIEnv *callEnv) {
+    if (callEnv == nullptr) {
+        return;
+    }
+    //the listener may restart or stop polling, which takes modbus_mutex again, so the call
+    //goes out without it on a reference of its own
+    jobject listener;
+    {
+        std::lock_guard<std::mutex> lock(modbus_mutex);
+        if (modbus_listener == nullptr) {
+            return;
+        }
+        listener = callEnv->NewLocalRef(modbus_listener);
+    }
+    //the arrays are only ever touched on the read side
+    const ModbusPoller::Cycle &cycle = modbus.cycle();
+    auto reads = static_cast<jsize>(cycle.status.size());
+    auto values = static_cast<jsize>(cycle.values.size());
+    if (modbus_status == nullptr || callEnv->GetArrayLength(modbus_status) != reads) {
+        if (modbus_status != nullptr) {
+            callEnv->DeleteGlobalRef(modbus_status);
+            callEnv->DeleteGlobalRef(modbus_offsets);
+        }
+        jintArray status = callEnv->NewIntArray(reads);
+        jintArray offsets = callEnv->NewIntArray(reads + 1);
+        modbus_status = static_cast<jintArray>(callEnv->NewGlobalRef(status));
+        modbus_offsets = static_cast<jintArray>(callEnv->NewGlobalRef(offsets));
+        callEnv->DeleteLocalRef(status);
+        callEnv->DeleteLocalRef(offsets);
+    }
+    if (modbus_values == nullptr || callEnv->GetArrayLength(modbus_values) != values) {
+        if (modbus_values != nullptr)
+            callEnv->DeleteGlobalRef(modbus_values);
+        jshortArray array = callEnv->NewShortArray(values);
+        modbus_values = static_cast<jshortArray>(callEnv->NewGlobalRef(array));
+        callEnv->DeleteLocalRef(array);
+    }
+    callEnv->SetIntArrayRegion(modbus_status, 0, reads, cycle.status.data());
+    callEnv->SetIntArrayRegion(modbus_offsets, 0, reads + 1, cycle.offsets.data());
+    callEnv->SetShortArrayRegion(modbus_values, 0, values,
+                                 reinterpret_cast<const jshort *>(cycle.values.data()));
+    const int64_t start = PortStats::now();
+    callEnv->CallVoidMethod(listener, g_jni_cache.onPollCycle,
+                            static_cast<jlong>(cycle.number), modbus_status, modbus_offsets,
+                            modbus_values);
+    stats.record(PortStats::CALLBACK_TIME, static_cast<uint64_t>(PortStats::now() - start));
+    callEnv->DeleteLocalRef(listener);
+}
+
+void SPReadWriteWorker::emitFrame(JNIEnv *callEnv) {
+    if (framer.frameSize() > 0) {
+        stats.add(dispatcher.hasListener() ? PortStats::FRAMES_IN : PortStats::DROPPED_FRAMES);
+    }
+    //the frame stays in the ring until the listener returned
+    dispatcher.deliver(callEnv, framer.frame(), framer.frameSize(),
+                       timeline.stamp(framer.buffer().position(), framer.frameSize()));
+    framer.release();
+}
+
+void SPReadWriteWorker::decodeFrames(JNIEnv *callEnv) {
+    RingBuffer &ring = framer.buffer();
+    FrameDecoder::Frame frame;
+    //a resync skips junk byte by byte, the whole run counts as one dropped frame
+    bool skipping = false;
+    while (ring.readable() > 0) {
+        size_t n = decoder->decode(ring.readPtr(), ring.readable(), frame);
+        if (n == 0) {
+            break;
+        }
+        if (frame.data == nullptr) {
+            if (!skipping)
+                stats.add(PortStats::DROPPED_FRAMES);
+            skipping = true;
+        } else if (frame.size > 0) {
+            skipping = false;
+            stats.add(dispatcher.hasListener() ? PortStats::FRAMES_IN : PortStats::DROPPED_FRAMES);
+            //decoded in place, the frame stays in the ring until the listener returned,
+            //stamped by its bytes on the wire, delimiter and escapes included
+            dispatcher.deliver(callEnv, frame.data, frame.size,
+                               timeline.stamp(ring.position(), n));
+        }
+        framer.consume(n);
+    }
+}
+
+void SPReadWriteWorker::onBatchTimeout(JNIEnv *callEnv) {
+    dispatcher.onTimer(callEnv);
 }
 
 SPReadWriteWorker::~SPReadWriteWorker() {
     LOGD("开始销毁SPReadWriteWorker");
     stop();
-    usleep(custom_read_interval + 5000);
+    if (reactor != nullptr) {
+        reactor->remove(_serialPort->getFileDescriptor());
+        reactor->remove(framer.getTimerFd());
+        if (dispatcher.getTimerFd() >= 0)
+            reactor->remove(dispatcher.getTimerFd());
+        reactor->remove(writer.getEventFd());
+        reactor->remove(writer.getTimerFd());
+        reactor->remove(transactions.getTimerFd());
+        reactor->remove(modbus.getTimerFd());
+    }
     if (write_thread != nullptr && write_thread->joinable())
         write_thread->join();
     if (read_thread != nullptr && read_thread->joinable())
         read_thread->join();
-    if (loop_thread != nullptr && loop_thread->joinable())
-        loop_thread->join();
-    std::queue<std::vector<char>>().swap(mByteMessages);
-    std::queue<std::vector<std::string>>().swap(mMessages);
     write_thread = nullptr;
     read_thread = nullptr;
+    //nothing runs on the read/write side any more, the rest is released from the calling thread
+    JNIEnv *callerEnv = nullptr;
+    if (g_vm == nullptr ||
+        g_vm->GetEnv(reinterpret_cast<void **>(&callerEnv), JNI_VERSION_1_6) != JNI_OK) {
+        callerEnv = nullptr;
+    }
+    if (reactor != nullptr && callerEnv != nullptr) {
+        //no read thread owns the callback in reactor mode
+        dispatcher.release(callerEnv);
+    }
+    transactions.cancelAll(results);
+    deliverResults(callerEnv);
+    if (write_listener != nullptr && callerEnv != nullptr) {
+        callerEnv->DeleteGlobalRef(write_listener);
+    }
+    write_listener = nullptr;
+    if (callerEnv != nullptr) {
+        for (jobject ref : {modbus_listener, static_cast<jobject>(modbus_status),
+                            static_cast<jobject>(modbus_offsets), static_cast<jobject>(modbus_values)}) {
+            if (ref != nullptr)
+                callerEnv->DeleteGlobalRef(ref);
+        }
+    }
+    modbus_listener = nullptr;
+    close(stop_event_fd);
+    stop_event_fd = -1;
     _serialPort->Close();
     _serialPort = nullptr;
     g_vm = nullptr;
-    jcallback = nullptr;
     env = nullptr;
 
 }
 
-void SPReadWriteWorker::writeMessage(const std::vector<std::string> &messages) {
-    for (auto &&c:messages) {
-        int len = c.length() / 2;
-        auto temp = new char[len];
-        HexToBytes(c, temp);
-        if (stopRequested()) {
-            return;
-        }
-        _serialPort->Write(temp, len);
-        delete[]temp;
-    }
-}
-
 void SPReadWriteWorker::writeLoop() {
-    std::unique_lock<std::mutex> lk(m_mutex);
-    while (true) {
-        cv.wait(lk,
-                [&] { return stopRequested() || !mMessages.empty() || !mByteMessages.empty(); });
+    if (g_vm != nullptr && g_vm->AttachCurrentThread(&write_env, nullptr) != 0) {
+        //completions are still tracked, there is just nobody to tell
+        LOGE("写线程附加到java虚拟机失败");
+        write_env = nullptr;
+    }
+    struct pollfd fds[4] = {};
+    fds[0].fd = writer.getEventFd();
+    fds[0].events = POLLIN;
+    fds[1].fd = stop_event_fd;
+    fds[1].events = POLLIN;
+    //only watched while the driver's output buffer is full, negative otherwise
+    fds[2].fd = -1;
+    fds[2].events = POLLOUT;
+    fds[3].fd = writer.getTimerFd();
+    fds[3].events = POLLIN;
+    while (!stopRequested()) {
+        if (poll(fds, 4, -1) <= 0) {
+            continue;
+        }
         if (stopRequested()) {
             break;
         }
-        if (!mMessages.empty()) {
-            auto commands = std::move(mMessages.front());
-            writeMessage(commands);
-            commands.clear();
-            mMessages.pop();
-            continue;
+        if (fds[3].revents & POLLIN) {
+            writer.onTimer();
         }
-        if (!mByteMessages.empty()) {
-            auto commands = std::move(mByteMessages.front());
-            _serialPort->Write(&commands[0], commands.size());
-            commands.clear();
-            mByteMessages.pop();
+        bool blocked;
+        if (fds[0].revents & POLLIN) {
+            blocked = writer.onEvent();
+        } else if (fds[2].revents != 0) {
+            blocked = writer.onWritable();
+        } else {
+            continue;
         }
+        fds[2].fd = blocked ? _serialPort->getFileDescriptor() : -1;
     }
     LOGD("写线程终止运行");
+    if (g_vm != nullptr && write_env != nullptr)
+        g_vm->DetachCurrentThread();
+    write_env = nullptr;
 }
 
 void SPReadWriteWorker::doWork(const std::vector<char> &msg) {
-    const std::lock_guard<std::mutex> lock(m_mutex);
-    mByteMessages.push(msg);
-    cv.notify_all();
+    doWork(msg, WRITE_FIRE_AND_FORGET, 0);
 }
 
+int SPReadWriteWorker::doWork(const std::vector<char> &msg, uint32_t flags, uint64_t key) {
+    WriteMessage message = {writer.acquireBuffer(), flags};
+    message.data.assign(msg.begin(), msg.end());
+    message.key = key;
+    return writer.enqueue(std::move(message));
+}
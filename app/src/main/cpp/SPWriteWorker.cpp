@@ -5,17 +5,7 @@
 #include <SPWriteWorker.h>
 #include <androidLog.h>
 #include <unistd.h>
-
-const int BIT16 = 16;
-
-static void HexToBytes(const std::string &hex, char *result) {
-    for (unsigned int i = 0; i < hex.length(); i += 2) {
-        std::string byteString = hex.substr(i, 2);
-        char byte = (char) strtol(byteString.c_str(), nullptr, BIT16);
-        *result = byte;
-        result++;
-    }
-}
+#include <HexCodec.h>
 
 SPWriteWorker::SPWriteWorker(const char *c_name, const int *baudrate) :
         _serialPort(new SerialPort(c_name, *baudrate)) {
@@ -40,6 +30,9 @@ void SPWriteWorker::doWork(const std::vector<std::string>& msgs) {
 void SPWriteWorker::internalWork(std::string &msg) {
     int len = msg.length() / 2;
     char temp[len];
-    HexToBytes(msg, temp);
+    if (!HexToBytes(msg.data(), msg.length(), temp)) {
+        LOGE("非法的16进制字符串: %s", msg.c_str());
+        return;
+    }
     _serialPort->Write(temp, len);
 }
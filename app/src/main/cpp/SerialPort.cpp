@@ -18,20 +18,30 @@
 #include <cerrno>    // Error number definitions
 #include <termios.h>    // POSIX terminal control definitions (struct termios)
 #include <system_error>    // For throwing std::system_error
+#include <algorithm>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>    // struct serial_struct, ASYNC_LOW_LATENCY
+#include <climits>
+#include <cstdlib>
 
 // User includes
 #include "includes/Exception.hpp"
 #include "includes/SerialPort.hpp"
+#include "includes/Termios2.h"
 
 namespace mn {
     namespace CppLinuxSerial {
 
         SerialPort::SerialPort() {
+            state_ = State::CLOSED;
+            fileDesc_ = -1;
             echo_ = false;
+            nonBlocking_ = false;
+            lowLatency_ = false;
             timeout_ms_ = defaultTimeout_ms_;
             custom_baudRate = 9600;
             readBufferSize_B_ = defaultReadBufferSize_B_;
-            readBuffer_.reserve(readBufferSize_B_);
         }
 
         SerialPort::SerialPort(const std::string &device, int baudRate) :
@@ -55,18 +65,32 @@ namespace mn {
             if (state_ == State::OPEN)
 
 
-                ConfigureTermios();
+                ConfigureTermios(configureOptions_);
         }
 
         void SerialPort::SetBaudRate(int baudRate) {
+            if (baudRate <= 0)
+                THROW_EXCEPT(std::string() + "baudRate provided to " + __PRETTY_FUNCTION__ +
+                             " must be positive.");
             custom_baudRate = baudRate;
             if (state_ == State::OPEN)
-                ConfigureTermios();
+                ConfigureTermios(configureOptions_);
+        }
+
+        void SerialPort::SetConfigureOptions(const ConfigureOptions &options) {
+            configureOptions_ = options;
+        }
+
+        void SerialPort::Configure(int baudRate, bool echo, const ConfigureOptions &options) {
+            custom_baudRate = baudRate;
+            echo_ = echo;
+            if (state_ == State::OPEN)
+                ConfigureTermios(options);
         }
 
         void SerialPort::Open() {
 
-            std::cout << "Attempting to open COM port \"" << device_ << "\"." << std::endl;
+            LOGD("Attempting to open COM port \"%s\".", device_.c_str());
 
             if (device_.empty()) {
                 THROW_EXCEPT("Attempted to open file when file path has not been assigned to.");
@@ -78,7 +102,7 @@ namespace mn {
             // O_RDONLY for read-only, O_WRONLY for write only, O_RDWR for both read/write access
             // 3rd, optional parameter is mode_t mode
 //            fileDesc_ = open(device_.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
-            fileDesc_ = open(device_.c_str(), O_RDWR |  O_NOCTTY );
+            fileDesc_ = open(device_.c_str(), O_RDWR | O_NOCTTY | (nonBlocking_ ? O_NONBLOCK : 0));
 
             // Check status
             if (fileDesc_ == -1) {
@@ -86,7 +110,9 @@ namespace mn {
                              ". Is the device name correct and do you have read/write permission?");
             }
 
-            ConfigureTermios();
+            ConfigureTermios(configureOptions_);
+            if (lowLatency_)
+                ApplyLowLatency();
 
 //            struct termios cfg;
 //            tcgetattr(fileDesc_, &cfg);
@@ -102,16 +128,80 @@ namespace mn {
 
         void SerialPort::SetEcho(bool value) {
             echo_ = value;
-            ConfigureTermios();
+            if (state_ == State::OPEN)
+                ConfigureTermios(configureOptions_);
+        }
+
+        void SerialPort::SetLowLatency(bool value) {
+            lowLatency_ = value;
+            if (state_ == State::OPEN)
+                ApplyLowLatency();
         }
 
-        void SerialPort::ConfigureTermios() {
-            std::cout << "Configuring COM port \"" << device_ << "\"." << std::endl;
+        void SerialPort::ApplyLowLatency() {
+            struct serial_struct serial = {};
+            if (ioctl(fileDesc_, TIOCGSERIAL, &serial) == 0) {
+                if (lowLatency_)
+                    serial.flags |= ASYNC_LOW_LATENCY;
+                else
+                    serial.flags &= ~ASYNC_LOW_LATENCY;
+                if (ioctl(fileDesc_, TIOCSSERIAL, &serial) != 0)
+                    LOGE("串口%s设置low_latency失败: %s", device_.c_str(), strerror(errno));
+            } else {
+                LOGE("串口%s不支持TIOCGSERIAL: %s", device_.c_str(), strerror(errno));
+            }
+
+            std::string timerPath = LatencyTimerPath();
+            if (timerPath.empty())
+                return;
+            int timerFd = open(timerPath.c_str(), O_WRONLY | O_CLOEXEC);
+            const char *value = lowLatency_ ? "1" : "16";
+            if (timerFd < 0 || write(timerFd, value, strlen(value)) < 0)
+                LOGE("写入%s失败: %s", timerPath.c_str(), strerror(errno));
+            if (timerFd >= 0)
+                close(timerFd);
+        }
+
+        LatencySettings SerialPort::GetLatencySettings() {
+            LatencySettings settings = {-EBADF, -1};
+            if (fileDesc_ < 0)
+                return settings;
+            struct serial_struct serial = {};
+            if (ioctl(fileDesc_, TIOCGSERIAL, &serial) == 0)
+                settings.lowLatency = (serial.flags & ASYNC_LOW_LATENCY) ? 1 : 0;
+            else
+                settings.lowLatency = -errno;
+
+            std::string timerPath = LatencyTimerPath();
+            if (!timerPath.empty()) {
+                std::ifstream timer(timerPath);
+                int value;
+                if (timer >> value)
+                    settings.latencyTimer_ms = value;
+            }
+            return settings;
+        }
+
+        std::string SerialPort::LatencyTimerPath() {
+            // Follow /dev/serial/by-id style links down to the tty node
+            char resolved[PATH_MAX];
+            if (realpath(device_.c_str(), resolved) == nullptr)
+                return std::string();
+            const char *name = strrchr(resolved, '/');
+            name = name != nullptr ? name + 1 : resolved;
+            // ftdi_sio exposes the attribute on the usb-serial port device the tty hangs off
+            std::string path = std::string("/sys/class/tty/") + name + "/device/latency_timer";
+            return access(path.c_str(), F_OK) == 0 ? path : std::string();
+        }
+
+        void SerialPort::ConfigureTermios(const ConfigureOptions &options) {
+            LOGD("Configuring COM port \"%s\".", device_.c_str());
 
             //================== CONFIGURE ==================//
 
-            termios tty = GetTermios();
-            speed_t speed;
+            // The whole configuration is built from one snapshot and applied at most once
+            const termios current = GetTermios();
+            termios tty = current;
 
             LOGD("input speed: %lu", (unsigned long) cfgetispeed(&tty));
             LOGD("output speed: %lu", (unsigned long) cfgetospeed(&tty));
@@ -128,8 +218,13 @@ namespace mn {
 
 
             //===================== (Baudrate) =================//
-            cfsetispeed(&tty, getBaudrate(custom_baudRate));
-            cfsetospeed(&tty, getBaudrate(custom_baudRate));
+            // Non-standard rates keep the current Bxxx here and are set through termios2 below
+            const speed_t speedConstant = getBaudrate(custom_baudRate);
+            const bool customRate = speedConstant == static_cast<speed_t>(-1);
+            if (!customRate) {
+                cfsetispeed(&tty, speedConstant);
+                cfsetospeed(&tty, speedConstant);
+            }
 
             //===================== (.c_oflag) =================//
 
@@ -185,7 +280,16 @@ namespace mn {
 
             // Try and use raw function call
             cfmakeraw(&tty);
-            this->SetTermios(tty);
+            this->SetTermios(tty, current, options);
+
+            if (customRate) {
+                int result = SetCustomBaudRate(fileDesc_, custom_baudRate);
+                if (result < 0)
+                    throw std::system_error(-result, std::system_category());
+            }
+            int actual = GetActualBaudRate();
+            if (actual > 0 && actual != custom_baudRate)
+                LOGD("串口%s请求波特率%d, 实际波特率%d", device_.c_str(), custom_baudRate, actual);
 
             /*
             // Flush port, then apply attributes
@@ -210,50 +314,63 @@ namespace mn {
                              " called but file descriptor < 0, indicating file has not been opened.");
             }
 
-            int writeResult = write(fileDesc_, data.c_str(), data.size());
-
-            // Check status
-            if (writeResult == -1) {
-                throw std::system_error(EFAULT, std::system_category());
-            }
+            struct iovec iov = {const_cast<char *>(data.data()), data.size()};
+            Write(&iov, 1);
         }
 
         void SerialPort::Read(std::string &data) {
-            data.clear();
+            // Read straight into data, its capacity is reused between calls
+            data.resize(readBufferSize_B_);
+            size_t n = Read(&data[0], data.size());
+            data.resize(n);
+        }
 
+        size_t SerialPort::Read(char *buffer, size_t capacity, bool *hangup) {
             if (fileDesc_ == 0) {
-                //this->sp->PrintError(SmartPrint::Ss() << "Read() was called but file descriptor (fileDesc) was 0, indicating file has not been opened.");
-                //return false;
                 THROW_EXCEPT(
                         "Read() was called but file descriptor (fileDesc) was 0, indicating file has not been opened.");
             }
 
-            // Allocate memory for read buffer
-//		char buf [256];
-//		memset (&buf, '\0', sizeof buf);
-
-            // Read from file
-            // We provide the underlying raw array from the readBuffer_ vector to this C api.
-            // This will work because we do not delete/resize the vector while this method
-            // is called
-            ssize_t n = read(fileDesc_, &readBuffer_[0], readBufferSize_B_);
+            ssize_t n;
+            do {
+                n = read(fileDesc_, buffer, std::min(capacity, readBufferSize_B_.load()));
+            } while (n < 0 && errno == EINTR);
 
             // Error Handling
             if (n < 0) {
+                // Nothing to read on an O_NONBLOCK port is not an error
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return 0;
                 // Read was unsuccessful
-                throw std::system_error(EFAULT, std::system_category());
+                throw std::system_error(errno, std::system_category());
             }
+            // A tty with data pending never returns 0, only once the other end is gone
+            if (hangup != nullptr)
+                *hangup = n == 0 && capacity > 0;
 
-            if (n > 0) {
+            return static_cast<size_t>(n);
+        }
 
-//			buf[n] = '\0';
-                //printf("%s\r\n", buf);
-//			data.append(buf);
-                data = std::string(&readBuffer_[0], n);
-                //std::cout << *str << " and size of string =" << str->size() << "\r\n";
+        size_t SerialPort::ReadInto(RingBuffer &ring, bool *hangup) {
+            char *dest = ring.writePtr();
+            size_t room = ring.writable();
+            if (room == 0) {
+                return 0;
             }
+            size_t n = Read(dest, room, hangup);
+            ring.commit(n);
+            return n;
+        }
 
-            // If code reaches here, read must of been successful
+        void SerialPort::SetReadBufferSize(size_t size) {
+            if (size == 0 || size > maxReadBufferSize_B_)
+                THROW_EXCEPT(std::string() + "size provided to " + __PRETTY_FUNCTION__ +
+                             " must be between 1 and " + std::to_string(maxReadBufferSize_B_) + ".");
+            readBufferSize_B_ = size;
+        }
+
+        size_t SerialPort::GetReadBufferSize() {
+            return readBufferSize_B_;
         }
 
         termios SerialPort::GetTermios() {
@@ -275,20 +392,31 @@ namespace mn {
             return tty;
         }
 
-        void SerialPort::SetTermios(termios myTermios) {
+        bool SerialPort::SetTermios(const termios &tty, const termios &current,
+                                    const ConfigureOptions &options) {
+            if (options.settleDelay_us > 0)
+                usleep(options.settleDelay_us);
             // Flush port, then apply attributes
-            usleep(10000);
-            tcflush(fileDesc_, TCIFLUSH);
+            if (options.flushInput)
+                tcflush(fileDesc_, TCIFLUSH);
+
+            // tty started as a copy of current, so any byte difference is a real change
+            if (memcmp(&tty, &current, sizeof(termios)) == 0) {
+                LOGD("串口%s配置未变化, 跳过tcsetattr", device_.c_str());
+                return false;
+            }
 
-            if (tcsetattr(fileDesc_, TCSANOW, &myTermios) != 0) {
+            if (tcsetattr(fileDesc_, TCSANOW, &tty) != 0) {
                 // Error occurred
+                int error = errno;
                 std::cout << "Could not apply terminal attributes for \"" << device_ << "\" - "
-                          << strerror(errno) << std::endl;
-                throw std::system_error(EFAULT, std::system_category());
+                          << strerror(error) << std::endl;
+                throw std::system_error(error, std::system_category());
 
             }
 
             // Successful!
+            return true;
         }
 
         void SerialPort::Close() {
@@ -303,6 +431,12 @@ namespace mn {
             state_ = State::CLOSED;
         }
 
+        void SerialPort::SetNonBlocking(bool value) {
+            if (state_ == State::OPEN)
+                THROW_EXCEPT(std::string() + __PRETTY_FUNCTION__ + " called while state == OPEN.");
+            nonBlocking_ = value;
+        }
+
         void SerialPort::SetTimeout(int32_t timeout_ms) {
             if (timeout_ms < -1)
                 THROW_EXCEPT(std::string() + "timeout_ms provided to " + __PRETTY_FUNCTION__ +
@@ -334,15 +468,108 @@ namespace mn {
                              " called but file descriptor < 0, indicating file has not been opened.");
             }
 
-            int writeResult = write(fileDesc_, bytes, static_cast<size_t>(len));
-            tcdrain(fileDesc_);
+            //no tcdrain here, callers that need the bytes on the wire call Drain()
+            struct iovec iov = {bytes, static_cast<size_t>(len)};
+            Write(&iov, 1);
+        }
 
-            // Check status
-            if (writeResult == -1) {
-                throw std::system_error(EFAULT, std::system_category());
+        void SerialPort::Write(struct iovec *iov, int count) {
+
+            if (state_ != State::OPEN)
+                THROW_EXCEPT(std::string() + __PRETTY_FUNCTION__ +
+                             " called but state != OPEN. Please call Open() first.");
+
+            while (count > 0) {
+                ssize_t n = WriteSome(iov, count);
+                if (n < 0) {
+                    throw std::system_error(static_cast<int>(-n), std::system_category());
+                }
+                if (n == 0) {
+                    // O_NONBLOCK port with a full output buffer, wait until it takes more
+                    struct pollfd pfd = {fileDesc_, POLLOUT, 0};
+                    poll(&pfd, 1, -1);
+                    continue;
+                }
+                // Skip the buffers that went out completely, trim the one cut short
+                while (count > 0 && static_cast<size_t>(n) >= iov->iov_len) {
+                    n -= iov->iov_len;
+                    ++iov;
+                    --count;
+                }
+                if (count > 0) {
+                    iov->iov_base = static_cast<char *>(iov->iov_base) + n;
+                    iov->iov_len -= n;
+                }
             }
         }
 
+        ssize_t SerialPort::WriteSome(const struct iovec *iov, int count) {
+            while (true) {
+                ssize_t n = writev(fileDesc_, iov, count);
+                if (n >= 0)
+                    return n;
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return 0;
+                return -errno;
+            }
+        }
+
+        int SerialPort::Drain() {
+            while (tcdrain(fileDesc_) != 0) {
+                if (errno != EINTR)
+                    return errno;
+            }
+            return 0;
+        }
+
+        int SerialPort::GetActualBaudRate() {
+            if (fileDesc_ < 0)
+                return -EBADF;
+            return ::GetActualBaudRate(fileDesc_);
+        }
+
+        int SerialPort::OutputPending() {
+            int queued = 0;
+            if (ioctl(fileDesc_, TIOCOUTQ, &queued) != 0)
+                return -errno;
+            return queued;
+        }
+
+        int SerialPort::InputPending() {
+            int queued = 0;
+            if (ioctl(fileDesc_, FIONREAD, &queued) != 0)
+                return -errno;
+            return queued;
+        }
+
+        int SerialPort::CharacterBits() {
+            struct termios tty = {};
+            if (fileDesc_ < 0 || tcgetattr(fileDesc_, &tty) != 0)
+                return 10;
+            int bits;
+            switch (tty.c_cflag & CSIZE) {
+                case CS5:
+                    bits = 5;
+                    break;
+                case CS6:
+                    bits = 6;
+                    break;
+                case CS7:
+                    bits = 7;
+                    break;
+                default:
+                    bits = 8;
+                    break;
+            }
+            return 1 + bits + ((tty.c_cflag & PARENB) ? 1 : 0) + ((tty.c_cflag & CSTOPB) ? 2 : 1);
+        }
+
+        int SerialPort::FlushInput() {
+            return tcflush(fileDesc_, TCIFLUSH) == 0 ? 0 : errno;
+        }
+
         SerialPort::SerialPort(const SerialPort &serialPort) {
             LOGD("开始复制,原是否开启");
         }
@@ -6,46 +6,156 @@
 
 SerialPortManager::SerialPortManager() = default;
 
+int SerialPortManager::addSerialPorts(std::vector<std::pair<std::string, WorkerFactory>> ports) {
+    std::vector<std::future<std::unique_ptr<IWorker>>> pending;
+    pending.reserve(ports.size());
+    for (auto &&port : ports) {
+        pending.push_back(std::async(std::launch::async, port.second));
+    }
+    int added = 0;
+    for (size_t i = 0; i < ports.size(); ++i) {
+        try {
+            addSerialPort(ports[i].first.c_str(), pending[i].get());
+            ++added;
+        } catch (const std::exception &e) {
+            LOGE("打开串口%s失败: %s", ports[i].first.c_str(), e.what());
+        }
+    }
+    return added;
+}
+
 int SerialPortManager::removeSerialPort(std::string path) {
     if (inner_map[path]) {
-        inner_map[path].reset(nullptr);
+        std::unique_ptr<IWorker> worker = std::move(inner_map[path]);
         inner_map.erase(path);
+        retire(std::move(worker));
         return 0;
     } else {
         return -1;
     }
 }
 
+void SerialPortManager::retire(std::unique_ptr<IWorker> worker) {
+    if (!worker) {
+        return;
+    }
+    if (worker->getCaptureTap() != nullptr)
+        capture.detach(worker->getCaptureTap());
+    if (reactor && reactor->inLoopThread()) {
+        std::shared_ptr<IWorker> closing(std::move(worker));
+        reactor->defer([closing]() mutable { closing.reset(); });
+    }
+}
+
 int
-SerialPortManager::sendMessage(std::string path, const std::vector<std::string> &msg) {
+SerialPortManager::sendMessage(std::string path, const std::vector<std::string> &msg,
+                               uint32_t flags, uint64_t key) {
     if (inner_map[path]) {
-        inner_map[path]->
-                doWork(msg);
-        return 0;
+        return inner_map[path]->
+                doWork(msg, flags, key);
     } else {
-        return -1;
+        return -ENODEV;
     }
 }
 
 SerialPortManager::~SerialPortManager() {
-    for (auto &r:inner_map) {
-        removeSerialPort(r.first);
-    }
+    //the capture must not drain workers that are gone,
+    //and workers must unregister from the reactor before it goes away
+    capture.stop();
+    inner_map.clear();
+    reactor.reset(nullptr);
 }
 
 bool SerialPortManager::hasSerialPort(std::string path) {
     return inner_map[path] != nullptr;
 }
 
-int SerialPortManager::sendBytesMessage(std::string path, const std::vector<char> &msg) {
+int SerialPortManager::sendBytesMessage(std::string path, const std::vector<char> &msg,
+                                        uint32_t flags, uint64_t key) {
+    if (inner_map[path]) {
+        return inner_map[path]->
+                doWork(msg, flags, key);
+    } else {
+        return -ENODEV;
+    }
+}
+
+int SerialPortManager::setWriteListener(std::string path, JNIEnv *env, jobject listener) {
     if (inner_map[path]) {
-        inner_map[path]->
-                doWork(msg);
+        inner_map[path]->setWriteListener(env, listener);
         return 0;
     } else {
         return -1;
     }
 }
 
+int SerialPortManager::getActualBaudRate(std::string path) {
+    if (inner_map[path]) {
+        return inner_map[path]->getActualBaudRate();
+    } else {
+        return -ENODEV;
+    }
+}
+
+mn::CppLinuxSerial::LatencySettings SerialPortManager::getLatencySettings(std::string path) {
+    if (inner_map[path]) {
+        return inner_map[path]->getLatencySettings();
+    } else {
+        return {-ENODEV, -1};
+    }
+}
+
+int SerialPortManager::getPortStats(std::string path, PortStats::Snapshot &snapshot) {
+    if (inner_map[path]) {
+        return inner_map[path]->getStats(snapshot) ? 0 : -ENOTSUP;
+    } else {
+        return -ENODEV;
+    }
+}
+
+int64_t SerialPortManager::submitTransaction(std::string path, JNIEnv *env,
+                                             std::vector<char> &&request,
+                                             ResponseMatcher &&matcher, uint32_t timeout_ms,
+                                             jobject listener) {
+    if (inner_map[path]) {
+        return inner_map[path]->submitTransaction(env, std::move(request), std::move(matcher),
+                                                  timeout_ms, listener);
+    } else {
+        return -ENODEV;
+    }
+}
+
+int SerialPortManager::startModbusPolling(std::string path, JNIEnv *env,
+                                          std::vector<ModbusRead> &&reads, uint32_t period_ms,
+                                          uint32_t timeout_ms, jobject listener) {
+    if (inner_map[path]) {
+        return inner_map[path]->startModbusPolling(env, std::move(reads), period_ms, timeout_ms,
+                                                   listener);
+    } else {
+        return -ENODEV;
+    }
+}
+
+void SerialPortManager::setReactorMode(bool enabled) {
+    reactor_mode = enabled;
+    LOGD("reactor模式: %d", enabled ? 1 : 0);
+}
 
+SerialPortReactor *SerialPortManager::getReactor(JavaVM *vm) {
+    if (!reactor_mode) {
+        return nullptr;
+    }
+    if (!reactor) {
+        reactor = std::make_unique<SerialPortReactor>(vm);
+    }
+    return reactor.get();
+}
 
+int SerialPortManager::startCapture(const std::string &dir, size_t segment_bytes,
+                                    int max_segments, const std::string &port) {
+    return capture.start(dir, segment_bytes, max_segments, port);
+}
+
+void SerialPortManager::stopCapture() {
+    capture.stop();
+}
@@ -0,0 +1,154 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include "includes/SerialPortReactor.h"
+#include "includes/androidLog.h"
+
+SerialPortReactor::SerialPortReactor(JavaVM *vm) :
+        epoll_fd(epoll_create1(EPOLL_CLOEXEC)),
+        wake_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+        running(true),
+        dispatching(false),
+        rounds(0),
+        loop_thread(nullptr),
+        g_vm(vm),
+        env(nullptr) {
+    if (epoll_fd < 0 || wake_fd < 0) {
+        std::__throw_runtime_error("创建epoll实例失败!");
+    }
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+    loop_thread = new std::thread(&SerialPortReactor::loop, this);
+}
+
+SerialPortReactor::~SerialPortReactor() {
+    LOGD("开始销毁SerialPortReactor");
+    running.store(false);
+    eventfd_write(wake_fd, 1);
+    if (loop_thread != nullptr && loop_thread->joinable())
+        loop_thread->join();
+    //ports closed by the last round, their workers still unregister here
+    std::vector<std::function<void()>> tasks;
+    tasks.swap(deferred);
+    for (auto &&task : tasks) {
+        task();
+    }
+    delete loop_thread;
+    loop_thread = nullptr;
+    handlers.clear();
+    close(wake_fd);
+    close(epoll_fd);
+    g_vm = nullptr;
+}
+
+int SerialPortReactor::add(int fd, uint32_t events, Handler handler) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    struct epoll_event ev = {};
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        LOGE("epoll添加fd %d 失败: %d", fd, errno);
+        return -errno;
+    }
+    handlers[fd] = std::make_shared<Handler>(std::move(handler));
+    return 0;
+}
+
+int SerialPortReactor::modify(int fd, uint32_t events) {
+    struct epoll_event ev = {};
+    ev.events = events;
+    ev.data.fd = fd;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0 ? 0 : -errno;
+}
+
+int SerialPortReactor::remove(int fd) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    handlers.erase(fd);
+    const int result = epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr) == 0 ? 0 : -errno;
+    if (!inLoopThread()) {
+        //the round in flight may have looked the handler up already
+        const uint64_t round = rounds;
+        round_done.wait(lock, [this, round] { return !dispatching || rounds != round; });
+    }
+    return result;
+}
+
+void SerialPortReactor::defer(std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    deferred.push_back(std::move(task));
+}
+
+JNIEnv *SerialPortReactor::getEnv() {
+    return env;
+}
+
+bool SerialPortReactor::inLoopThread() {
+    return loop_thread != nullptr && std::this_thread::get_id() == loop_thread->get_id();
+}
+
+void SerialPortReactor::loop() {
+    if (g_vm != nullptr && g_vm->AttachCurrentThread(&env, nullptr) != 0) {
+        LOGE("reactor线程附加到java虚拟机失败");
+        env = nullptr;
+    }
+    struct epoll_event events[MAX_EVENTS];
+    while (running.load()) {
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            LOGE("epoll_wait失败: %d", errno);
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            dispatching = true;
+        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd) {
+                eventfd_t ignored;
+                eventfd_read(wake_fd, &ignored);
+                continue;
+            }
+            std::shared_ptr<Handler> handler;
+            {
+                //the handler may have been removed by an earlier event of this round
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto it = handlers.find(fd);
+                if (it == handlers.end())
+                    continue;
+                handler = it->second;
+            }
+            try {
+                (*handler)(events[i].events);
+            } catch (const std::exception &e) {
+                //one broken port must not take the others down with it
+                LOGE("reactor处理fd %d 出错: %s", fd, e.what());
+            }
+        }
+        std::vector<std::function<void()>> tasks;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            dispatching = false;
+            ++rounds;
+            tasks.swap(deferred);
+        }
+        round_done.notify_all();
+        //nothing of the round is on the stack any more
+        for (auto &&task : tasks) {
+            task();
+        }
+    }
+    LOGD("Reactor Thread end");
+    if (g_vm != nullptr && env != nullptr)
+        g_vm->DetachCurrentThread();
+    env = nullptr;
+}
@@ -0,0 +1,431 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <unistd.h>
+#include "includes/SerialWriter.h"
+#include "includes/RxTimeline.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+SerialWriter::SerialWriter(mn::CppLinuxSerial::SerialPort *port, size_t max_messages,
+                           size_t max_bytes) :
+        port(port),
+        queue(max_messages, max_bytes, QUEUE_BLOCK),
+        pool(BUFFER_POOL_CAPACITY),
+        idle(true),
+        stopped(false),
+        event_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+        timer_fd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+        stats(nullptr),
+        capture(nullptr),
+        drain_sequence(0),
+        batch_head(0),
+        carry{},
+        has_carry(false),
+        suspended{},
+        has_suspended(false),
+        chunk_size(0),
+        total_written(0) {
+    batch.reserve(IOV_MAX);
+    iov.reserve(IOV_MAX);
+}
+
+SerialWriter::~SerialWriter() {
+    ::close(event_fd);
+    ::close(timer_fd);
+    event_fd = -1;
+    timer_fd = -1;
+}
+
+int SerialWriter::getEventFd() {
+    return event_fd;
+}
+
+int SerialWriter::getTimerFd() {
+    return timer_fd;
+}
+
+std::vector<char> SerialWriter::acquireBuffer() {
+    std::vector<char> bytes;
+    const std::lock_guard<std::mutex> lock(producer_mutex);
+    pool.pop(bytes);
+    bytes.clear();
+    return bytes;
+}
+
+int SerialWriter::enqueue(WriteMessage &&message) {
+    return enqueue(std::move(message), true);
+}
+
+int SerialWriter::tryEnqueue(WriteMessage &&message) {
+    return enqueue(std::move(message), false);
+}
+
+int SerialWriter::enqueue(WriteMessage &&message, bool wait) {
+    const bool drain = (message.flags & WRITE_DRAIN_AFTER) != 0;
+    if (stats != nullptr) {
+        message.enqueued_ns = PortStats::now();
+    }
+    std::unique_lock<std::mutex> lock(producer_mutex);
+    WriteQueue::PushResult result;
+    while (true) {
+        if (drain) {
+            message.sequence = ++drain_sequence;
+        }
+        //never sleeps with the lock held, a refused message is left untouched
+        result = queue.push(std::move(message), false);
+        if (!result.would_block || !wait) {
+            break;
+        }
+        if (drain) {
+            --drain_sequence;
+        }
+        //other producers go on meanwhile, this one takes a new sequence once there is room
+        lock.unlock();
+        queue.waitForRoom(message.data.size());
+        lock.lock();
+    }
+    if (stats != nullptr) {
+        stats->raise(PortStats::QUEUE_HIGH_WATER, result.depth);
+        if (result.error != 0 || result.evicted > 0) {
+            stats->add(PortStats::QUEUE_REJECTIONS, result.error != 0 ? 1 : result.evicted);
+        }
+        //evicted messages are lost, a refused one is reported back to the caller
+        if (result.evicted > 0 || result.error == -EPIPE) {
+            stats->add(PortStats::DROPPED_FRAMES, result.error == -EPIPE ? 1 : result.evicted);
+        }
+        if (result.coalesced) {
+            stats->add(PortStats::QUEUE_COALESCED);
+        }
+    }
+    if (result.error != 0) {
+        if (drain) {
+            //nobody will hear about this sequence, hand it to the next message
+            --drain_sequence;
+        }
+        return result.error;
+    }
+    lock.unlock();
+    //only pay for the syscall when the writer went to sleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (idle.exchange(false)) {
+        eventfd_write(event_fd, 1);
+    }
+    return 0;
+}
+
+void SerialWriter::setQueueLimits(size_t max_messages, size_t max_bytes, QueuePolicy policy) {
+    queue.setLimits(max_messages, max_bytes, policy);
+}
+
+void SerialWriter::setChunkSize(size_t size) {
+    chunk_size.store(size);
+}
+
+void SerialWriter::close() {
+    stopped.store(true);
+    queue.close();
+    eventfd_write(event_fd, 1);
+}
+
+void SerialWriter::stop() {
+    close();
+    failAll(EPIPE);
+}
+
+void SerialWriter::setErrorHandler(ErrorHandler handler) {
+    on_error = std::move(handler);
+}
+
+void SerialWriter::setCompletionHandler(CompletionHandler handler) {
+    on_complete = std::move(handler);
+}
+
+void SerialWriter::setStats(PortStats *portStats) {
+    stats = portStats;
+}
+
+void SerialWriter::setCapture(CaptureChannel *channel) {
+    capture = channel;
+}
+
+bool SerialWriter::onEvent() {
+    eventfd_t ignored;
+    eventfd_read(event_fd, &ignored);
+    return pump();
+}
+
+bool SerialWriter::onWritable() {
+    return pump();
+}
+
+void SerialWriter::onTimer() {
+    uint64_t expirations;
+    read(timer_fd, &expirations, sizeof(expirations));
+    pollCompletions();
+}
+
+bool SerialWriter::pump() {
+    while (!stopped.load()) {
+        idle.store(false);
+        Progress progress = EMPTY;
+        while (!stopped.load() && (progress = writeBatch()) == WROTE) {
+        }
+        if (progress == BLOCKED) {
+            //stay non-idle, producers need not signal, whatever they queue is picked up on POLLOUT
+            return true;
+        }
+        //publish idle before the final emptiness check, pairs with the fence in enqueue
+        idle.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (queue.size() == 0) {
+            break;
+        }
+    }
+    if (stopped.load()) {
+        //closed from another thread
+        failAll(EPIPE);
+    }
+    return false;
+}
+
+bool SerialWriter::fillBatch() {
+    const size_t chunk = chunk_size.load(std::memory_order_relaxed);
+    const size_t budget = chunk > 0 ? chunk : MAX_BATCH_BYTES;
+    batch_head = 0;
+    if (has_carry) {
+        batch.push_back(std::move(carry));
+        has_carry = false;
+    } else if (has_suspended && !queue.hasPriority()) {
+        //input was flushed when it first went out, if asked to
+        batch.push_back(std::move(suspended));
+        has_suspended = false;
+        return true;
+    }
+    size_t batch_bytes = batch.empty() ? 0 : batch.front().data.size();
+    bool alone = chunk > 0 && batch_bytes > chunk;
+    WriteMessage message;
+    //while a large message waits for its turn only the priority lane may overtake it
+    while (!alone && batch.size() < IOV_MAX && batch_bytes < budget &&
+           queue.pop(message, has_suspended)) {
+        const bool large = chunk > 0 && message.data.size() > chunk;
+        if (!batch.empty() && ((message.flags & WRITE_FLUSH_BEFORE) || large)) {
+            //everything ahead of it has to reach the driver before the input is flushed,
+            //and a large message goes out on its own
+            carry = std::move(message);
+            has_carry = true;
+            break;
+        }
+        batch_bytes += message.data.size();
+        batch.push_back(std::move(message));
+        alone = large;
+    }
+    if (batch.empty()) {
+        return false;
+    }
+    if ((batch.front().flags & WRITE_FLUSH_BEFORE) && batch.front().written == 0) {
+        port->FlushInput();
+    }
+    return true;
+}
+
+bool SerialWriter::yieldToPriority(size_t chunk) {
+    //the batch of a large message holds nothing else
+    WriteMessage &m = batch[batch_head];
+    if (batch_head + 1 != batch.size() || (m.flags & WRITE_PRIORITY) || m.written == 0 ||
+        m.written % chunk != 0 || !queue.hasPriority()) {
+        return false;
+    }
+    suspended = std::move(m);
+    has_suspended = true;
+    batch.pop_back();
+    finishBatch();
+    return true;
+}
+
+SerialWriter::Progress SerialWriter::writeBatch() {
+    if (batch.empty() && !fillBatch()) {
+        return EMPTY;
+    }
+    const size_t chunk = chunk_size.load(std::memory_order_relaxed);
+    iov.clear();
+    size_t requested = 0;
+    for (size_t i = batch_head; i < batch.size(); ++i) {
+        WriteMessage &m = batch[i];
+        if (m.written < m.data.size()) {
+            size_t len = m.data.size() - m.written;
+            if (chunk > 0) {
+                //only ever cuts a large message, smaller ones fit in their first chunk
+                len = std::min(len, chunk - m.written % chunk);
+            }
+            iov.push_back({m.data.data() + m.written, len});
+            requested += len;
+        }
+    }
+    if (!iov.empty()) {
+        const int64_t start = stats != nullptr ? PortStats::now() : 0;
+        ssize_t n = port->WriteSome(iov.data(), static_cast<int>(iov.size()));
+        if (stats != nullptr) {
+            stats->record(PortStats::SYSCALL_TIME, static_cast<uint64_t>(PortStats::now() - start));
+            stats->add(PortStats::WRITE_CALLS);
+            if (n > 0) {
+                stats->add(PortStats::BYTES_OUT, static_cast<uint64_t>(n));
+            }
+            if (n > 0 && static_cast<size_t>(n) < requested) {
+                stats->add(PortStats::SHORT_WRITES);
+            }
+        }
+        if (n == 0) {
+            return BLOCKED;
+        }
+        if (n > 0 && capture != nullptr && capture->enabled()) {
+            capture->push(RxTimeline::now(), iov.data(), static_cast<int>(iov.size()),
+                          static_cast<size_t>(n));
+        }
+        if (n < 0) {
+            //nothing of this call reached the driver, the error belongs to the first pending message
+            advance(0);
+            fail(batch[batch_head++], static_cast<int>(-n));
+            advance(0);
+        } else {
+            advance(static_cast<size_t>(n));
+        }
+        if (batch_head < batch.size()) {
+            //a chunk went out, or a short write after which the next round most likely
+            //gets EAGAIN and waits for POLLOUT
+            if (chunk > 0) {
+                yieldToPriority(chunk);
+            }
+            return WROTE;
+        }
+    } else {
+        //nothing but empty messages, e.g. the marker flush() queues, their completions still count
+        advance(0);
+    }
+    finishBatch();
+    return WROTE;
+}
+
+void SerialWriter::advance(size_t n) {
+    bool added = false;
+    while (batch_head < batch.size()) {
+        WriteMessage &m = batch[batch_head];
+        size_t step = std::min(n, m.data.size() - m.written);
+        m.written += step;
+        n -= step;
+        total_written += step;
+        if (m.written < m.data.size()) {
+            break;
+        }
+        if (stats != nullptr && !m.data.empty()) {
+            stats->add(PortStats::FRAMES_OUT);
+            stats->record(PortStats::QUEUE_WAIT,
+                          static_cast<uint64_t>(PortStats::now() - m.enqueued_ns));
+        }
+        if (m.flags & WRITE_DRAIN_AFTER) {
+            pending.emplace_back(total_written, m.sequence);
+            added = true;
+        }
+        ++batch_head;
+    }
+    if (added) {
+        //completes right away when the driver is already empty, otherwise arms the timer
+        pollCompletions();
+    }
+}
+
+void SerialWriter::fail(WriteMessage &message, int error) {
+    if (stats != nullptr) {
+        stats->add(PortStats::DROPPED_FRAMES);
+    }
+    if (on_error) {
+        on_error(message, error);
+    }
+    if ((message.flags & WRITE_DRAIN_AFTER) && on_complete) {
+        on_complete(message.sequence, error);
+    }
+    //do not send the rest of it later, nor report it as transmitted
+    message.written = message.data.size();
+    message.flags &= ~WRITE_DRAIN_AFTER;
+}
+
+void SerialWriter::failAll(int error) {
+    //already went out, nobody polls TIOCOUTQ for them any more
+    for (auto &&p : pending) {
+        if (on_complete) {
+            on_complete(p.second, error);
+        }
+    }
+    pending.clear();
+    struct itimerspec spec = {};
+    timerfd_settime(timer_fd, 0, &spec, nullptr);
+    for (size_t i = batch_head; i < batch.size(); ++i) {
+        fail(batch[i], error);
+    }
+    finishBatch();
+    if (has_suspended) {
+        fail(suspended, error);
+        has_suspended = false;
+    }
+    if (has_carry) {
+        fail(carry, error);
+        has_carry = false;
+    }
+    WriteMessage message;
+    while (queue.pop(message)) {
+        fail(message, error);
+    }
+}
+
+void SerialWriter::pollCompletions() {
+    if (pending.empty()) {
+        return;
+    }
+    int queued = port->OutputPending();
+    if (queued < 0) {
+        //without TIOCOUTQ there is no telling what went out, give up on all of them
+        for (auto &&p : pending) {
+            if (on_complete) {
+                on_complete(p.second, -queued);
+            }
+        }
+        pending.clear();
+        return;
+    }
+    const uint64_t sent = total_written - static_cast<uint64_t>(queued);
+    while (!pending.empty() && pending.front().first <= sent) {
+        if (on_complete) {
+            on_complete(pending.front().second, 0);
+        }
+        pending.pop_front();
+    }
+    struct itimerspec spec = {};
+    if (!pending.empty()) {
+        spec.it_value.tv_nsec = DRAIN_POLL_INTERVAL_US * 1000;
+    }
+    timerfd_settime(timer_fd, 0, &spec, nullptr);
+}
+
+void SerialWriter::finishBatch() {
+    for (auto &&m : batch) {
+        recycle(std::move(m.data));
+    }
+    batch.clear();
+    iov.clear();
+    batch_head = 0;
+}
+
+void SerialWriter::recycle(std::vector<char> &&bytes) {
+    //huge one-off payloads are not worth keeping around
+    if (bytes.capacity() > 0 && bytes.capacity() <= MAX_POOLED_BUFFER_SIZE) {
+        pool.push(std::move(bytes));
+    }
+}
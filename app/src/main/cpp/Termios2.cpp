@@ -0,0 +1,31 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+#include <cerrno>
+#include "includes/Termios2.h"
+
+int SetCustomBaudRate(int fd, int baudRate) {
+    struct termios2 tio = {};
+    if (ioctl(fd, TCGETS2, &tio) != 0) {
+        return -errno;
+    }
+    tio.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+    tio.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+    tio.c_ospeed = static_cast<speed_t>(baudRate);
+    tio.c_ispeed = static_cast<speed_t>(baudRate);
+    if (ioctl(fd, TCSETS2, &tio) != 0) {
+        return -errno;
+    }
+    return 0;
+}
+
+int GetActualBaudRate(int fd) {
+    struct termios2 tio = {};
+    if (ioctl(fd, TCGETS2, &tio) != 0) {
+        return -errno;
+    }
+    return static_cast<int>(tio.c_ospeed);
+}
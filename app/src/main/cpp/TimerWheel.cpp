@@ -0,0 +1,49 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <algorithm>
+#include "includes/TimerWheel.h"
+
+TimerWheel::TimerWheel(uint32_t tick_ms, size_t slots, uint64_t now_ms) :
+        slots(slots),
+        tick_ms(tick_ms),
+        current_tick(now_ms / tick_ms),
+        count(0) {
+}
+
+void TimerWheel::schedule(uint64_t id, uint64_t deadline_ms) {
+    //round up so a timer never fires early, and never into a slot already passed
+    uint64_t deadline_tick = std::max((deadline_ms + tick_ms - 1) / tick_ms, current_tick + 1);
+    slots[deadline_tick % slots.size()].push_back({id, deadline_tick});
+    ++count;
+}
+
+void TimerWheel::advance(uint64_t now_ms, std::vector<uint64_t> &expired) {
+    const uint64_t now_tick = now_ms / tick_ms;
+    if (now_tick <= current_tick) {
+        return;
+    }
+    //after a long stall every slot is visited once at most
+    const uint64_t steps = std::min<uint64_t>(now_tick - current_tick, slots.size());
+    for (uint64_t i = 1; i <= steps; ++i) {
+        auto &slot = slots[(current_tick + i) % slots.size()];
+        auto due = std::partition(slot.begin(), slot.end(), [now_tick](const Entry &e) {
+            return e.deadline_tick > now_tick;
+        });
+        for (auto it = due; it != slot.end(); ++it) {
+            expired.push_back(it->id);
+        }
+        count -= static_cast<size_t>(slot.end() - due);
+        slot.erase(due, slot.end());
+    }
+    current_tick = now_tick;
+}
+
+size_t TimerWheel::size() {
+    return count;
+}
+
+uint32_t TimerWheel::tick() {
+    return tick_ms;
+}
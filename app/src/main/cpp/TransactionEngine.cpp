@@ -0,0 +1,249 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <stdexcept>
+#include "includes/TransactionEngine.h"
+
+ResponseMatcher ResponseMatcher::Length(size_t length) {
+    ResponseMatcher matcher = {LENGTH, length, {}, nullptr, ChecksumSpec()};
+    return matcher;
+}
+
+ResponseMatcher ResponseMatcher::Delimiter(std::vector<char> delimiter) {
+    ResponseMatcher matcher = {DELIMITER, 0, std::move(delimiter), nullptr, ChecksumSpec()};
+    return matcher;
+}
+
+ResponseMatcher
+ResponseMatcher::Predicate(std::function<size_t(const char *data, size_t len)> predicate) {
+    ResponseMatcher matcher = {PREDICATE, 0, {}, std::move(predicate), ChecksumSpec()};
+    return matcher;
+}
+
+TransactionEngine::TransactionEngine(Sender sender) :
+        sender(std::move(sender)),
+        timer_fd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+        armed(false),
+        window(1),
+        next_id(0),
+        wheel(TICK_MS, WHEEL_SLOTS, nowMs()) {
+    if (timer_fd < 0) {
+        std::__throw_runtime_error("创建timerfd失败!");
+    }
+}
+
+TransactionEngine::~TransactionEngine() {
+    close(timer_fd);
+    timer_fd = -1;
+}
+
+int TransactionEngine::getTimerFd() {
+    return timer_fd;
+}
+
+void TransactionEngine::setWindow(size_t size) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        window = std::max<size_t>(size, 1);
+        pump();
+    }
+    send();
+}
+
+uint64_t TransactionEngine::submit(std::vector<char> &&request, ResponseMatcher &&matcher,
+                                   uint32_t timeout_ms) {
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        id = ++next_id;
+        pending.push_back({id, std::move(request), std::move(matcher), 0});
+        live.insert(id);
+        wheel.schedule(id, nowMs() + timeout_ms);
+        arm(true);
+        pump();
+    }
+    send();
+    return id;
+}
+
+bool TransactionEngine::inFlight() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !in_flight.empty();
+}
+
+size_t TransactionEngine::onData(const char *data, size_t len, std::vector<Result> &done) {
+    size_t n;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (in_flight.empty()) {
+            return 0;
+        }
+        Transaction &head = in_flight.front();
+        n = match(head, data, len);
+        if (n == 0) {
+            return 0;
+        }
+        int status = ChecksumVerify(head.matcher.checksum, data, n) ? 0 : -EBADMSG;
+        done.push_back({head.id, status, std::vector<char>(data, data + n)});
+        live.erase(head.id);
+        in_flight.pop_front();
+        pump();
+    }
+    send();
+    return n;
+}
+
+size_t TransactionEngine::match(Transaction &t, const char *data, size_t len) {
+    switch (t.matcher.type) {
+        case ResponseMatcher::LENGTH:
+            return len >= t.matcher.length ? t.matcher.length : 0;
+        case ResponseMatcher::DELIMITER: {
+            const auto &delimiter = t.matcher.delimiter;
+            if (delimiter.empty() || len < delimiter.size()) {
+                return 0;
+            }
+            //only look at what arrived since the last call, plus a possibly split delimiter
+            size_t from = t.scanned >= delimiter.size() ? t.scanned - delimiter.size() + 1 : 0;
+            const char *found = std::search(data + from, data + len, delimiter.begin(),
+                                            delimiter.end());
+            if (found == data + len) {
+                t.scanned = len;
+                return 0;
+            }
+            return static_cast<size_t>(found - data) + delimiter.size();
+        }
+        case ResponseMatcher::PREDICATE:
+            return t.matcher.predicate ? std::min(t.matcher.predicate(data, len), len) : 0;
+    }
+    return 0;
+}
+
+void TransactionEngine::onTimer(std::vector<Result> &done) {
+    uint64_t expirations;
+    read(timer_fd, &expirations, sizeof(expirations));
+    std::vector<uint64_t> expired;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto &&result : refused) {
+            done.push_back(std::move(result));
+        }
+        refused.clear();
+        wheel.advance(nowMs(), expired);
+        auto timedOut = [this, &expired](const Transaction &t) {
+            return live.count(t.id) != 0 &&
+                   std::find(expired.begin(), expired.end(), t.id) != expired.end();
+        };
+        for (auto *queue : {&in_flight, &pending}) {
+            for (auto &&t : *queue) {
+                if (timedOut(t)) {
+                    done.push_back({t.id, -ETIMEDOUT, {}});
+                }
+            }
+            queue->erase(std::remove_if(queue->begin(), queue->end(), timedOut), queue->end());
+        }
+        for (auto &&id : expired) {
+            live.erase(id);
+        }
+        pump();
+        arm(!live.empty());
+    }
+    send();
+}
+
+void TransactionEngine::cancelAll(std::vector<Result> &done) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto *queue : {&in_flight, &pending}) {
+        for (auto &&t : *queue) {
+            done.push_back({t.id, -ECANCELED, {}});
+        }
+        queue->clear();
+    }
+    for (auto &&result : refused) {
+        done.push_back(std::move(result));
+    }
+    refused.clear();
+    outbox.clear();
+    live.clear();
+    arm(false);
+}
+
+void TransactionEngine::pump() {
+    while (!pending.empty() && in_flight.size() < window) {
+        in_flight.push_back(std::move(pending.front()));
+        pending.pop_front();
+        //the request is not needed once it is handed to the writer
+        outbox.emplace_back(in_flight.back().id, std::move(in_flight.back().request));
+    }
+}
+
+void TransactionEngine::send() {
+    std::lock_guard<std::mutex> order(send_mutex);
+    std::vector<std::pair<uint64_t, std::vector<char>>> batch;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            batch.swap(outbox);
+            outbox.clear();
+            //timed out or cancelled since they were moved in flight
+            batch.erase(std::remove_if(batch.begin(), batch.end(),
+                                       [this](const std::pair<uint64_t, std::vector<char>> &r) {
+                                           return live.count(r.first) == 0;
+                                       }), batch.end());
+        }
+        if (batch.empty()) {
+            return;
+        }
+        //the sender may take a lock of its own (the write queue), never while m_mutex is held
+        for (auto &&r : batch) {
+            int error = sender(std::move(r.second));
+            if (error != 0) {
+                //may free a window slot for the next pending request, the loop sends it
+                refuse(r.first, error);
+            }
+        }
+    }
+}
+
+void TransactionEngine::refuse(uint64_t id, int error) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (live.erase(id) == 0) {
+        return;
+    }
+    in_flight.erase(std::remove_if(in_flight.begin(), in_flight.end(), [id](const Transaction &t) {
+        return t.id == id;
+    }), in_flight.end());
+    refused.push_back({id, error, {}});
+    pump();
+    //fire now instead of on the next tick, the read side may be waiting for nothing else
+    struct itimerspec spec = {};
+    spec.it_value.tv_nsec = 1;
+    spec.it_interval.tv_nsec = TICK_MS * 1000000L;
+    timerfd_settime(timer_fd, 0, &spec, nullptr);
+    armed = true;
+}
+
+void TransactionEngine::arm(bool on) {
+    if (on == armed) {
+        return;
+    }
+    //ticks only while something can expire
+    struct itimerspec spec = {};
+    if (on) {
+        spec.it_value.tv_nsec = TICK_MS * 1000000L;
+        spec.it_interval.tv_nsec = TICK_MS * 1000000L;
+    }
+    timerfd_settime(timer_fd, 0, &spec, nullptr);
+    armed = on;
+}
+
+uint64_t TransactionEngine::nowMs() {
+    struct timespec ts = {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000 + static_cast<uint64_t>(ts.tv_nsec) / 1000000;
+}
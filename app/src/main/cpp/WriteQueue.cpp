@@ -0,0 +1,166 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include "includes/WriteQueue.h"
+
+WriteQueue::WriteQueue(size_t max_messages, size_t max_bytes, QueuePolicy policy) :
+        queued_messages(0),
+        queued_bytes(0),
+        priority_pending(0),
+        max_messages(std::max<size_t>(max_messages, 1)),
+        max_bytes(max_bytes),
+        policy(policy),
+        blocked(0),
+        closed(false) {
+}
+
+void WriteQueue::setLimits(size_t messageLimit, size_t byteLimit, QueuePolicy queuePolicy) {
+    std::lock_guard<std::mutex> lock(mutex);
+    max_messages = std::max<size_t>(messageLimit, 1);
+    max_bytes = byteLimit;
+    policy = queuePolicy;
+    //higher limits may let blocked producers in
+    not_full.notify_all();
+}
+
+bool WriteQueue::fits(size_t bytes) {
+    //a message larger than max_bytes still goes through alone, it would wait forever otherwise
+    return queued_messages == 0 ||
+           (queued_messages < max_messages && queued_bytes + bytes <= max_bytes);
+}
+
+bool WriteQueue::replaceable(const WriteMessage &message) {
+    return !(message.flags & WRITE_DRAIN_AFTER);
+}
+
+WriteQueue::Lane WriteQueue::laneOf(const WriteMessage &message) {
+    return (message.flags & WRITE_PRIORITY) ? PRIORITY_LANE : NORMAL_LANE;
+}
+
+bool WriteQueue::evictOldest() {
+    for (auto lane : {NORMAL_LANE, PRIORITY_LANE}) {
+        auto &messages = lanes[lane];
+        auto it = std::find_if(messages.begin(), messages.end(), replaceable);
+        if (it == messages.end()) {
+            continue;
+        }
+        queued_bytes -= it->data.size();
+        --queued_messages;
+        messages.erase(it);
+        if (lane == PRIORITY_LANE)
+            priority_pending.store(messages.size(), std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+bool WriteQueue::replaceKeyed(WriteMessage &message) {
+    if (message.key == 0 || !replaceable(message)) {
+        return false;
+    }
+    auto &messages = lanes[laneOf(message)];
+    auto it = std::find_if(messages.rbegin(), messages.rend(), [&](const WriteMessage &m) {
+        return m.key == message.key && replaceable(m);
+    });
+    if (it == messages.rend() || queued_bytes - it->data.size() + message.data.size() > max_bytes) {
+        return false;
+    }
+    //keeps the old place in line, the newest state goes out as early as the stale one would have
+    queued_bytes = queued_bytes - it->data.size() + message.data.size();
+    *it = std::move(message);
+    return true;
+}
+
+WriteQueue::PushResult WriteQueue::push(WriteMessage &&message, bool wait) {
+    PushResult result = {0, 0, false, 0, false};
+    std::unique_lock<std::mutex> lock(mutex);
+    const size_t bytes = message.data.size();
+    if (!closed && (message.flags & WRITE_LATEST) && replaceKeyed(message)) {
+        result.coalesced = true;
+        result.depth = queued_messages;
+        return result;
+    }
+    while (!closed && !fits(bytes)) {
+        if (policy == QUEUE_BLOCK && !wait) {
+            result.error = -EAGAIN;
+            result.depth = queued_messages;
+            result.would_block = true;
+            return result;
+        } else if (policy == QUEUE_BLOCK) {
+            ++blocked;
+            not_full.wait(lock);
+            --blocked;
+        } else if (policy == QUEUE_DROP_OLDEST && evictOldest()) {
+            ++result.evicted;
+        } else if (policy == QUEUE_COALESCE && replaceKeyed(message)) {
+            result.coalesced = true;
+            result.depth = queued_messages;
+            return result;
+        } else {
+            result.error = -EAGAIN;
+            result.depth = queued_messages;
+            return result;
+        }
+    }
+    if (closed) {
+        result.error = -EPIPE;
+        return result;
+    }
+    const Lane lane = laneOf(message);
+    queued_bytes += bytes;
+    ++queued_messages;
+    lanes[lane].push_back(std::move(message));
+    if (lane == PRIORITY_LANE)
+        priority_pending.store(lanes[lane].size(), std::memory_order_relaxed);
+    result.depth = queued_messages;
+    return result;
+}
+
+void WriteQueue::waitForRoom(size_t bytes) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!closed && policy == QUEUE_BLOCK && !fits(bytes)) {
+        ++blocked;
+        not_full.wait(lock);
+        --blocked;
+    }
+}
+
+bool WriteQueue::pop(WriteMessage &message, bool priority_only) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Lane lane = PRIORITY_LANE;
+    if (lanes[PRIORITY_LANE].empty()) {
+        if (priority_only || lanes[NORMAL_LANE].empty()) {
+            return false;
+        }
+        lane = NORMAL_LANE;
+    }
+    auto &messages = lanes[lane];
+    message = std::move(messages.front());
+    messages.pop_front();
+    if (lane == PRIORITY_LANE)
+        priority_pending.store(messages.size(), std::memory_order_relaxed);
+    queued_bytes -= message.data.size();
+    --queued_messages;
+    if (blocked > 0) {
+        not_full.notify_all();
+    }
+    return true;
+}
+
+size_t WriteQueue::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queued_messages;
+}
+
+bool WriteQueue::hasPriority() {
+    return priority_pending.load(std::memory_order_relaxed) > 0;
+}
+
+void WriteQueue::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    not_full.notify_all();
+}
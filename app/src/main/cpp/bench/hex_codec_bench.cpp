@@ -0,0 +1,61 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+// Decoding throughput of HexToBytes against the original substr + strtol loop, for the
+// multi-KB screen frames pushed through sendMessage.
+// Host only: build the hex_codec_bench target.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "../includes/HexCodec.h"
+
+using Clock = std::chrono::steady_clock;
+
+//the implementation SPReadWriteWorker and SPWriteWorker used before HexCodec
+static void LegacyHexToBytes(const std::string &hex, char *result) {
+    for (unsigned int i = 0; i < hex.length(); i += 2) {
+        std::string byteString = hex.substr(i, 2);
+        char byte = (char) strtol(byteString.c_str(), nullptr, 16);
+        *result = byte;
+        result++;
+    }
+}
+
+template<typename F>
+static double measure(const std::string &hex, int rounds, F decode) {
+    auto start = Clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        decode();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return hex.size() * static_cast<double>(rounds) / seconds / (1024 * 1024);
+}
+
+int main() {
+    printf("build: %s\n", BENCH_BUILD_TYPE);
+    printf("kernel: %s\n", HexCodecKernel());
+    printf("%8s %14s %14s %14s\n", "bytes", "legacy MB/s", "scalar MB/s", "simd MB/s");
+    const char digits[] = "0123456789ABCDEFabcdef";
+    for (size_t size : {16, 256, 4096, 65536}) {
+        std::string hex(size * 2, '0');
+        for (auto &c : hex) {
+            c = digits[rand() % 22];
+        }
+        std::vector<char> out(size);
+        int rounds = static_cast<int>(64 * 1024 * 1024 / hex.size());
+        double legacy = measure(hex, rounds / 16 + 1, [&] {
+            LegacyHexToBytes(hex, out.data());
+        });
+        double scalar = measure(hex, rounds, [&] {
+            HexToBytesScalar(hex.data(), hex.size(), out.data());
+        });
+        double simd = measure(hex, rounds, [&] {
+            HexToBytes(hex.data(), hex.size(), out.data());
+        });
+        printf("%8zu %14.1f %14.1f %14.1f\n", size, legacy, scalar, simd);
+    }
+    return 0;
+}
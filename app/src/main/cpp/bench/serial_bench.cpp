@@ -0,0 +1,285 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+// Loopback benchmark of the read, write and framing paths of mserialport_core over openpty() pairs.
+// The slave end is driven through SerialPort like a real device node, the master end plays the
+// device. A pty does not pace by baud rate, so the device side throttles itself to baud / 10
+// bytes per second ("raw" = unthrottled) to mimic the line.
+// Reports throughput, p50/p99/p999 latency per message and process CPU time per byte, the latter
+// includes the simulated device side.
+// Host only: build the serial_bench target, optional argument is the seconds spent per case.
+
+#include <pty.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../includes/SerialPort.hpp"
+#include "../includes/SerialWriter.h"
+#include "../includes/IdleFramer.h"
+#include "../includes/RingBuffer.h"
+
+using namespace mn::CppLinuxSerial;
+using Clock = std::chrono::steady_clock;
+
+static const int BAUD_RATES[] = {0, 115200, 921600, 3000000};
+static const size_t MESSAGE_SIZES[] = {8, 64, 512, 4096};
+//smallest idle gap of the framing case, slower lines use 3.5 character times (as Modbus does)
+static constexpr useconds_t MIN_FRAME_GAP_US = 200;
+static constexpr size_t MIN_MESSAGES = 20;
+static constexpr size_t MAX_MESSAGES = 20000;
+
+static double seconds_per_case = 0.2;
+
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now().time_since_epoch()).count();
+}
+
+static int64_t cpuNs() {
+    struct timespec ts = {};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+//one pty pair with the slave opened through SerialPort
+struct Loopback {
+    int master = -1;
+    int slave = -1;
+    std::unique_ptr<SerialPort> port;
+
+    explicit Loopback(int baud) {
+        char name[128];
+        if (openpty(&master, &slave, name, nullptr, nullptr) != 0) {
+            perror("openpty");
+            exit(1);
+        }
+        port.reset(new SerialPort(name, baud > 0 ? baud : 115200));
+        port->SetNonBlocking(true);
+        port->Open();
+        //keep the master in raw mode as well, the line discipline must not touch the bytes
+        struct termios tio = {};
+        tcgetattr(master, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(master, TCSANOW, &tio);
+    }
+
+    ~Loopback() {
+        port->Close();
+        close(slave);
+        close(master);
+    }
+};
+
+//sleeps until sent bytes fit the simulated line rate, no-op for raw
+struct Pacer {
+    int baud;
+    Clock::time_point start = Clock::now();
+
+    void wait(size_t bytes_sent) {
+        if (baud <= 0)
+            return;
+        auto due = start + std::chrono::microseconds(bytes_sent * 10 * 1000000 / baud);
+        std::this_thread::sleep_until(due);
+    }
+};
+
+static size_t messageCount(int baud, size_t size) {
+    double per_second = baud > 0 ? baud / 10.0 / size : 1e9;
+    auto count = static_cast<size_t>(per_second * seconds_per_case);
+    return std::max(MIN_MESSAGES, std::min(MAX_MESSAGES, count));
+}
+
+static void writeAll(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            struct pollfd pfd = {fd, POLLOUT, 0};
+            poll(&pfd, 1, 100);
+            continue;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+}
+
+static void report(const char *path, int baud, size_t size, size_t count, int64_t wall_ns,
+                   int64_t cpu_ns, std::vector<double> &latency_us) {
+    if (latency_us.empty()) {
+        printf("%-7s baud=%-8d size=%-5zu no samples\n", path, baud, size);
+        return;
+    }
+    std::sort(latency_us.begin(), latency_us.end());
+    auto pct = [&](double p) {
+        return latency_us[static_cast<size_t>(p * (latency_us.size() - 1))];
+    };
+    const double bytes = static_cast<double>(count * size);
+    char rate[16];
+    if (baud > 0)
+        snprintf(rate, sizeof(rate), "%d", baud);
+    else
+        snprintf(rate, sizeof(rate), "raw");
+    printf("%-7s baud=%-8s size=%-5zu msgs=%-6zu %9.2f MB/s  p50=%8.1fus p99=%8.1fus "
+           "p999=%8.1fus  cpu=%7.2f ns/B\n",
+           path, rate, size, count, bytes / (wall_ns / 1e9) / 1e6, pct(0.5), pct(0.99), pct(0.999),
+           cpu_ns / bytes);
+}
+
+//device -> SerialPort::ReadInto, latency from the device writing a message to the last of its
+//bytes landing in the ring
+static void benchRead(int baud, size_t size) {
+    Loopback loop(baud);
+    const size_t count = messageCount(baud, size);
+    std::unique_ptr<std::atomic<int64_t>[]> sent(new std::atomic<int64_t>[count]);
+    std::vector<double> latency;
+    latency.reserve(count);
+    RingBuffer ring(64 * 1024);
+
+    const int64_t wall = nowNs(), cpu = cpuNs();
+    std::thread device([&] {
+        std::vector<char> message(size, 'r');
+        Pacer pacer = {baud};
+        for (size_t i = 0; i < count; ++i) {
+            pacer.wait(i * size);
+            sent[i].store(nowNs());
+            writeAll(loop.master, message.data(), size);
+        }
+    });
+    size_t received = 0, done = 0;
+    struct pollfd pfd = {loop.port->getFileDescriptor(), POLLIN, 0};
+    while (done < count) {
+        if (poll(&pfd, 1, 1000) <= 0)
+            break;
+        received += loop.port->ReadInto(ring);
+        ring.consume(ring.readable());
+        while (done < count && received >= (done + 1) * size) {
+            latency.push_back((nowNs() - sent[done].load()) / 1e3);
+            ++done;
+        }
+    }
+    device.join();
+    report("read", baud, size, done, nowNs() - wall, cpuNs() - cpu, latency);
+}
+
+//SerialWriter -> device, latency from enqueue to the device having read the whole message,
+//the writer runs on its own thread like SPReadWriteWorker::writeLoop
+static void benchWrite(int baud, size_t size) {
+    Loopback loop(baud);
+    const size_t count = messageCount(baud, size);
+    std::unique_ptr<std::atomic<int64_t>[]> queued(new std::atomic<int64_t>[count]);
+    std::vector<double> latency;
+    latency.reserve(count);
+    SerialWriter writer(loop.port.get(), 256, 1024 * 1024);
+    int stop_fd = eventfd(0, EFD_NONBLOCK);
+
+    std::thread writeLoop([&] {
+        struct pollfd fds[3] = {{writer.getEventFd(), POLLIN, 0},
+                                {stop_fd,             POLLIN, 0},
+                                {-1,                  POLLOUT, 0}};
+        while (true) {
+            if (poll(fds, 3, -1) <= 0)
+                continue;
+            if (fds[1].revents & POLLIN)
+                break;
+            bool blocked = (fds[0].revents & POLLIN) ? writer.onEvent() : writer.onWritable();
+            fds[2].fd = blocked ? loop.port->getFileDescriptor() : -1;
+        }
+    });
+    const int64_t wall = nowNs(), cpu = cpuNs();
+    std::thread device([&] {
+        //the device drains at line rate
+        std::vector<char> buffer(64 * 1024);
+        Pacer pacer = {baud};
+        size_t received = 0, done = 0;
+        struct pollfd pfd = {loop.master, POLLIN, 0};
+        while (done < count) {
+            if (poll(&pfd, 1, 1000) <= 0)
+                break;
+            pacer.wait(received);
+            ssize_t n = read(loop.master, buffer.data(), buffer.size());
+            if (n <= 0)
+                continue;
+            received += static_cast<size_t>(n);
+            while (done < count && received >= (done + 1) * size) {
+                latency.push_back((nowNs() - queued[done].load()) / 1e3);
+                ++done;
+            }
+        }
+    });
+    //the sender keeps to the line rate too, otherwise the latency is just queueing time
+    Pacer sender = {baud};
+    for (size_t i = 0; i < count; ++i) {
+        sender.wait(i * size);
+        WriteMessage message = {writer.acquireBuffer(), WRITE_FIRE_AND_FORGET};
+        message.data.assign(size, 'w');
+        queued[i].store(nowNs());
+        writer.enqueue(std::move(message));
+    }
+    device.join();
+    const int64_t wall_ns = nowNs() - wall, cpu_ns = cpuNs() - cpu;
+    writer.stop();
+    eventfd_write(stop_fd, 1);
+    writeLoop.join();
+    close(stop_fd);
+    report("write", baud, size, latency.size(), wall_ns, cpu_ns, latency);
+}
+
+//device -> IdleFramer, one message at a time, latency from the device writing a message to the
+//frame being cut, which includes the idle gap. The pty hands a message over at once, so the
+//baud rate only changes the gap here
+static void benchFraming(int baud, size_t size) {
+    Loopback loop(baud);
+    const size_t count = std::max(MIN_MESSAGES, messageCount(baud, size) / 4);
+    std::vector<double> latency;
+    latency.reserve(count);
+    const auto gap = baud > 0 ? std::max(MIN_FRAME_GAP_US, static_cast<useconds_t>(35000000LL / baud))
+                              : MIN_FRAME_GAP_US;
+    IdleFramer framer(gap, 64 * 1024);
+    std::vector<char> message(size, 'f');
+    struct pollfd fds[2] = {{loop.port->getFileDescriptor(), POLLIN, 0},
+                            {framer.getTimerFd(),            POLLIN, 0}};
+
+    const int64_t wall = nowNs(), cpu = cpuNs();
+    for (size_t i = 0; i < count; ++i) {
+        const int64_t start = nowNs();
+        writeAll(loop.master, message.data(), size);
+        bool framed = false;
+        while (!framed) {
+            if (poll(fds, 2, 1000) <= 0)
+                break;
+            if (fds[0].revents & POLLIN) {
+                loop.port->ReadInto(framer.buffer());
+                framed = framer.onData();
+            }
+            if ((fds[1].revents & POLLIN) && framer.expired())
+                framed = true;
+        }
+        if (framer.frameSize() == size) {
+            latency.push_back((nowNs() - start) / 1e3);
+        }
+        framer.release();
+    }
+    report("framing", baud, size, latency.size(), nowNs() - wall, cpuNs() - cpu, latency);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1)
+        seconds_per_case = atof(argv[1]);
+    printf("build: %s\n", BENCH_BUILD_TYPE);
+    for (int baud : BAUD_RATES) {
+        for (size_t size : MESSAGE_SIZES) {
+            benchRead(baud, size);
+            benchWrite(baud, size);
+            benchFraming(baud, size);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,212 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+// Enqueue latency of the per-port write queue while another thread hammers read() on a pty,
+// comparing the old shared mutex/condition_variable design (reader holds the lock across
+// read(), like the original readLoop) with SpscQueue + eventfd.
+// Host only: build the spsc_queue_bench target.
+
+#include <pty.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "../includes/SpscQueue.h"
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr int MESSAGES = 200000;
+static constexpr size_t MESSAGE_SIZE = 32;
+//time the java listener spends per received chunk, held under the lock by the old readLoop
+static constexpr auto CALLBACK_COST = std::chrono::microseconds(20);
+
+//gap between enqueues, roughly what a busy java sender produces
+static constexpr auto SEND_INTERVAL = std::chrono::microseconds(2);
+
+static void spinFor(Clock::duration d) {
+    auto until = Clock::now() + d;
+    while (Clock::now() < until) {
+    }
+}
+
+static void simulateCallback() {
+    spinFor(CALLBACK_COST);
+}
+
+struct ReadStorm {
+    int master = -1;
+    int slave = -1;
+    std::atomic<bool> running{true};
+    std::thread feeder;
+
+    ReadStorm() {
+        if (openpty(&master, &slave, nullptr, nullptr, nullptr) != 0) {
+            perror("openpty");
+            exit(1);
+        }
+        //raw mode so the line discipline does not buffer until newline
+        struct termios tio = {};
+        tcgetattr(slave, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(slave, TCSANOW, &tio);
+        fcntl(master, F_SETFL, O_NONBLOCK);
+        feeder = std::thread([this] {
+            char chunk[4096] = {};
+            while (running.load()) {
+                if (write(master, chunk, sizeof(chunk)) < 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    ~ReadStorm() {
+        running.store(false);
+        feeder.join();
+        close(master);
+        close(slave);
+    }
+};
+
+static void report(const char *name, std::vector<long> &samples) {
+    std::sort(samples.begin(), samples.end());
+    auto pct = [&](double p) {
+        return samples[static_cast<size_t>(p * (samples.size() - 1))];
+    };
+    printf("%-12s enqueue ns  p50=%-7ld p99=%-7ld p999=%-8ld max=%ld\n",
+           name, pct(0.5), pct(0.99), pct(0.999), samples.back());
+}
+
+static void benchSharedLock() {
+    ReadStorm storm;
+    std::mutex m_mutex;
+    std::condition_variable cv;
+    std::queue<std::vector<char>> queue;
+    std::atomic<bool> stop{false};
+    std::atomic<int> consumed{0};
+
+    std::thread reader([&] {
+        char buf[255];
+        struct pollfd fd = {storm.slave, POLLIN, 0};
+        while (!stop.load()) {
+            if (poll(&fd, 1, 10) <= 0)
+                continue;
+            std::lock_guard<std::mutex> lk(m_mutex);
+            read(storm.slave, buf, sizeof(buf));
+            simulateCallback();
+        }
+    });
+    std::thread writer([&] {
+        std::unique_lock<std::mutex> lk(m_mutex);
+        while (consumed.load() < MESSAGES) {
+            cv.wait(lk, [&] { return !queue.empty(); });
+            queue.pop();
+            consumed++;
+        }
+    });
+
+    std::vector<long> samples;
+    samples.reserve(MESSAGES);
+    for (int i = 0; i < MESSAGES; ++i) {
+        std::vector<char> msg(MESSAGE_SIZE);
+        spinFor(SEND_INTERVAL);
+        auto start = Clock::now();
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            queue.push(std::move(msg));
+            cv.notify_all();
+        }
+        samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - start).count());
+    }
+    writer.join();
+    stop.store(true);
+    reader.join();
+    report("shared_lock", samples);
+}
+
+static void benchSpsc() {
+    ReadStorm storm;
+    SpscQueue<std::vector<char>> queue(4096);
+    int wake_fd = eventfd(0, EFD_NONBLOCK);
+    std::atomic<bool> writer_idle{false};
+    //a full queue puts the producer to sleep until the writer made room, no spinning or sleep loop
+    int room_fd = eventfd(0, EFD_NONBLOCK);
+    std::atomic<bool> producer_waiting{false};
+    std::atomic<bool> stop{false};
+
+    std::thread reader([&] {
+        char buf[255];
+        struct pollfd fd = {storm.slave, POLLIN, 0};
+        while (!stop.load()) {
+            if (poll(&fd, 1, 10) > 0 && read(storm.slave, buf, sizeof(buf)) > 0)
+                simulateCallback();
+        }
+    });
+    std::thread writer([&] {
+        struct pollfd fd = {wake_fd, POLLIN, 0};
+        int consumed = 0;
+        std::vector<char> msg;
+        while (consumed < MESSAGES) {
+            while (queue.pop(msg))
+                consumed++;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (producer_waiting.exchange(false))
+                eventfd_write(room_fd, 1);
+            writer_idle.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (queue.size() == 0)
+                poll(&fd, 1, 10);
+            writer_idle.store(false);
+            eventfd_t ignored;
+            eventfd_read(wake_fd, &ignored);
+        }
+    });
+
+    std::vector<long> samples;
+    samples.reserve(MESSAGES);
+    for (int i = 0; i < MESSAGES; ++i) {
+        std::vector<char> msg(MESSAGE_SIZE);
+        spinFor(SEND_INTERVAL);
+        auto start = Clock::now();
+        while (!queue.push(std::move(msg))) {
+            //same handshake as the writer's idle flag, the other way round
+            struct pollfd fd = {room_fd, POLLIN, 0};
+            producer_waiting.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (queue.size() == queue.capacity())
+                poll(&fd, 1, 10);
+            producer_waiting.store(false);
+            eventfd_t ignored;
+            eventfd_read(room_fd, &ignored);
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (writer_idle.exchange(false))
+            eventfd_write(wake_fd, 1);
+        samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - start).count());
+    }
+    writer.join();
+    stop.store(true);
+    reader.join();
+    close(wake_fd);
+    close(room_fd);
+    report("spsc", samples);
+}
+
+int main() {
+    printf("build: %s\n", BENCH_BUILD_TYPE);
+    printf("%d messages of %zu bytes, concurrent pty read storm\n", MESSAGES, MESSAGE_SIZE);
+    benchSharedLock();
+    benchSpsc();
+    return 0;
+}
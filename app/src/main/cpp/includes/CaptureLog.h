@@ -0,0 +1,209 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_CAPTURELOG_H
+#define MSERIALPORT_CAPTURELOG_H
+
+#include <sys/uio.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Segment file layout, native byte order (little endian on every Android ABI):
+//a CaptureFileHeader, then CaptureRecords, each followed by its payload padded to 8 bytes.
+//header.used is refreshed after every drain pass, so a file cut short by a crash is still
+//readable up to it. Records of different ports and directions are not sorted by time,
+//within one port and direction they are.
+enum CaptureRecordType : uint8_t {
+    //bytes read from the port
+    CAPTURE_RX = 0,
+    //bytes the driver accepted for sending
+    CAPTURE_TX = 1,
+    //payload is the path of port, written at the start of every segment and on attach
+    CAPTURE_PORT = 2,
+    //payload is a uint32_t count of records lost because the staging buffer was full
+    CAPTURE_DROPPED = 3,
+};
+
+struct CaptureFileHeader {
+    //"MSPCAP01"
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    //counts the segments of one capture from 0
+    uint64_t sequence;
+    //CLOCK_REALTIME and CLOCK_MONOTONIC_RAW taken together when the segment was created,
+    //record times are CLOCK_MONOTONIC_RAW like the receive timestamps of RxTimeline
+    int64_t created_realtime_ns;
+    int64_t created_raw_ns;
+    //bytes of the file holding data, header included
+    uint64_t used;
+    char reserved[16];
+};
+
+struct CaptureRecord {
+    int64_t time_ns;
+    uint16_t port;
+    uint8_t type;
+    uint8_t reserved;
+    uint32_t length;
+};
+
+//Lock-free staging buffer for the traffic of one port in one direction, filled by the one
+//thread that reads (or writes) the port and drained by CaptureLog. The producer never blocks:
+//a record that does not fit is dropped and counted. Memory is only taken on the first enable.
+class CaptureChannel {
+public:
+    CaptureChannel();
+
+    CaptureChannel(const CaptureChannel &) = delete;
+
+    CaptureChannel &operator=(const CaptureChannel &) = delete;
+
+    //producer, a single load while capture is off
+    bool enabled() {
+        return on.load(std::memory_order_acquire);
+    }
+
+    //producer only, payloads larger than MAX_RECORD_PAYLOAD become several records
+    void push(int64_t time_ns, const char *data, size_t len);
+
+    //producer only, the first len bytes spread over iov
+    void push(int64_t time_ns, const struct iovec *iov, int count, size_t len);
+
+    //consumer side, called by CaptureLog with its mutex held
+    void enable();
+
+    void disable();
+
+    //the oldest staged record, false when there is none
+    bool front(int64_t &time_ns, uint32_t &len);
+
+    //copies the payload of the front record
+    void read(char *dst, uint32_t len);
+
+    void pop(uint32_t len);
+
+    //drops everything staged, e.g. what came in after the previous capture stopped
+    void discard();
+
+    uint64_t dropped();
+
+    static constexpr size_t MAX_RECORD_PAYLOAD = 16 * 1024;
+
+private:
+    struct Header {
+        int64_t time_ns;
+        uint32_t length;
+        uint32_t reserved;
+    };
+
+    static size_t recordSize(size_t len);
+
+    void copyIn(size_t pos, const void *src, size_t len);
+
+    void copyOut(size_t pos, void *dst, size_t len);
+
+    static constexpr size_t CAPACITY = 256 * 1024;
+    std::unique_ptr<char[]> buffer;
+    std::atomic<bool> on;
+    std::atomic<uint64_t> drops;
+    //consumer and producer indices live on separate cache lines
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+};
+
+//what a port feeds into the capture, owned by its worker
+struct CaptureTap {
+    CaptureChannel rx;
+    CaptureChannel tx;
+};
+
+//Writes the traffic of the attached ports into preallocated, memory mapped segment files
+//capture_<start time>_<sequence>.mspcap in one directory, starting the next segment when one
+//is full and deleting the oldest beyond max_segments. One background thread drains the
+//staging buffers every DRAIN_INTERVAL_MS, so the ports' read and write paths only copy.
+class CaptureLog {
+public:
+    CaptureLog();
+
+    virtual ~CaptureLog();
+
+    //0 or -errno. port selects the port path to capture, empty for every port including the
+    //ones attached later. A running capture is stopped first
+    int start(const std::string &dir, size_t segment_bytes, int max_segments,
+              const std::string &port);
+
+    //drains what is staged and closes the segment
+    void stop();
+
+    //taps stay attached for the lifetime of their port, captured or not
+    void attach(const std::string &name, CaptureTap *tap);
+
+    //drains the tap, it is never touched again once this returns
+    void detach(CaptureTap *tap);
+
+    static constexpr size_t MIN_SEGMENT_BYTES = 64 * 1024;
+
+private:
+    struct Entry {
+        CaptureTap *tap;
+        std::string name;
+        uint16_t id;
+        bool captured;
+        //drop counts already reported
+        uint64_t rx_dropped;
+        uint64_t tx_dropped;
+    };
+
+    void run();
+
+    //call with mutex held
+    bool selected(const Entry &entry);
+
+    void setCaptured(Entry &entry, bool captured);
+
+    bool drain(Entry &entry);
+
+    bool drain(Entry &entry, CaptureChannel &channel, CaptureRecordType type, uint64_t &reported);
+
+    //room for a record with len payload bytes in the current segment, rotating when needed,
+    //null when no segment could be opened
+    char *reserve(uint32_t len);
+
+    char *append(int64_t time_ns, uint16_t port, CaptureRecordType type, uint32_t len);
+
+    bool announce(const Entry &entry);
+
+    int openSegment();
+
+    void closeSegment();
+
+    static constexpr int DRAIN_INTERVAL_MS = 10;
+    //guards entries and the segment, the drain thread holds it for a whole pass
+    std::mutex mutex;
+    std::vector<Entry> entries;
+    uint16_t next_id;
+    bool active;
+    std::string dir;
+    std::string port;
+    size_t segment_bytes;
+    int max_segments;
+    int64_t start_time_s;
+    uint64_t sequence;
+    std::deque<std::string> segments;
+    int fd;
+    char *map;
+    size_t used;
+    int stop_event_fd;
+    std::thread thread;
+};
+
+#endif //MSERIALPORT_CAPTURELOG_H
@@ -0,0 +1,73 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_CHECKSUM_H
+#define MSERIALPORT_CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+//CRCs the frame protocols on our ports use, the values match SerialPortManager.CHECKSUM_*
+enum ChecksumType : int {
+    //poly 0x07, SMBus PEC
+    CHECKSUM_CRC8 = 0,
+    //poly 0x31 reflected, Dallas/Maxim 1-Wire
+    CHECKSUM_CRC8_MAXIM = 1,
+    //poly 0x8005 reflected, init 0xFFFF
+    CHECKSUM_CRC16_MODBUS = 2,
+    //poly 0x1021, init 0xFFFF (CRC-16/CCITT-FALSE)
+    CHECKSUM_CRC16_CCITT = 3,
+    //poly 0x1021, init 0
+    CHECKSUM_CRC16_XMODEM = 4,
+    //IEEE 802.3 / zlib
+    CHECKSUM_CRC32 = 5,
+    //Castagnoli
+    CHECKSUM_CRC32C = 6,
+    CHECKSUM_TYPE_COUNT
+};
+
+//how ChecksumUpdate() works through the data, anything but AUTO is meant for benchmarks
+enum ChecksumKernel {
+    CHECKSUM_AUTO,
+    //one table lookup per byte
+    CHECKSUM_BYTEWISE,
+    //eight tables, eight bytes per step
+    CHECKSUM_SLICING_BY_8,
+    //ARMv8 CRC32 instructions, SSE4.2 crc32 (CRC32C) or PCLMUL folding (CRC32),
+    //slicing-by-8 where the cpu has none for the type
+    CHECKSUM_HARDWARE,
+};
+
+bool ChecksumValidType(int type);
+
+//bytes the checksum takes on the wire
+size_t ChecksumWidth(ChecksumType type);
+
+//Streaming use: state = ChecksumInit(), ChecksumUpdate() for every piece, then ChecksumFinal()
+uint32_t ChecksumInit(ChecksumType type);
+
+uint32_t ChecksumUpdate(ChecksumType type, uint32_t state, const void *data, size_t len,
+                        ChecksumKernel kernel = CHECKSUM_AUTO);
+
+uint32_t ChecksumFinal(ChecksumType type, uint32_t state);
+
+uint32_t Checksum(ChecksumType type, const void *data, size_t len);
+
+//name of the kernel CHECKSUM_AUTO picks for type on this cpu
+const char *ChecksumKernelName(ChecksumType type);
+
+//a checksum at the end of a frame, as frame decoders and transactions check it
+struct ChecksumSpec {
+    //a ChecksumType, -1 for none
+    int type = -1;
+    //leading bytes it does not cover, e.g. a start byte
+    size_t skip = 0;
+    bool big_endian = false;
+};
+
+//true when the last ChecksumWidth() bytes of frame hold the checksum of the bytes between
+//skip and them, or when spec has no type
+bool ChecksumVerify(const ChecksumSpec &spec, const char *frame, size_t len);
+
+#endif //MSERIALPORT_CHECKSUM_H
@@ -0,0 +1,151 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_FRAMEDECODER_H
+#define MSERIALPORT_FRAMEDECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Checksum.h"
+
+//which decoder a port uses, the values match SerialPortManager.FrameDecoder on the java side
+struct FrameDecoderSpec {
+    enum Type {
+        //frames are cut by the idle gap (IdleFramer)
+        NONE = 0,
+        //params: {length}
+        FIXED_LENGTH = 1,
+        //params: {field offset, field width 1/2/4, big endian 0/1, adjustment}, the frame is
+        //offset + width + field value + adjustment bytes long, header included
+        LENGTH_FIELD = 2,
+        //delimiter: one or more bytes ending every frame, not part of the delivered frame
+        DELIMITER = 3,
+        //consistent overhead byte stuffing, frames end with 0x00
+        COBS = 4,
+        //RFC 1055, frames end with 0xC0
+        SLIP = 5,
+    };
+
+    int type = NONE;
+    std::vector<int> params;
+    std::vector<char> delimiter;
+    //frames failing it are dropped as junk, the checksum stays part of the delivered frame
+    ChecksumSpec checksum;
+};
+
+//Streaming decoder that finds complete frames in the unconsumed bytes of the receive ring.
+//It works on the ring in place: plain formats hand out a view of the ring, escaped formats
+//(COBS, SLIP) are unescaped in place once complete, so nothing is copied.
+//Decoders remember how far they already scanned, the owner must consume exactly what decode()
+//returned before the next call, and call reset() whenever it drops bytes on its own.
+class FrameDecoder {
+public:
+    struct Frame {
+        //null when the consumed bytes were junk (bad length, broken escaping), size 0 for an
+        //empty frame between two delimiters, which is skipped quietly
+        char *data = nullptr;
+        size_t size = 0;
+    };
+
+    //null for NONE or invalid parameters, max_frame is the receive ring capacity
+    static std::unique_ptr<FrameDecoder> create(const FrameDecoderSpec &spec, size_t max_frame);
+
+    virtual ~FrameDecoder() {}
+
+    //data/len are the unconsumed bytes, starting where the previous frame ended.
+    //Returns how many of them make up the next frame (0 while it is incomplete)
+    virtual size_t decode(char *data, size_t len, Frame &frame) = 0;
+
+    virtual void reset() {}
+
+private:
+    //the decoder for spec.type alone
+    static std::unique_ptr<FrameDecoder> createFraming(const FrameDecoderSpec &spec,
+                                                       size_t max_frame);
+};
+
+class FixedLengthDecoder : public FrameDecoder {
+public:
+    explicit FixedLengthDecoder(size_t length);
+
+    size_t decode(char *data, size_t len, Frame &frame) override;
+
+private:
+    size_t length;
+};
+
+class LengthFieldDecoder : public FrameDecoder {
+public:
+    LengthFieldDecoder(size_t offset, size_t width, bool big_endian, int adjustment,
+                       size_t max_frame);
+
+    size_t decode(char *data, size_t len, Frame &frame) override;
+
+private:
+    size_t offset;
+    size_t width;
+    bool big_endian;
+    int adjustment;
+    size_t max_frame;
+};
+
+//base of the decoders whose frames end with a delimiter, scanning resumes where it stopped
+class DelimitedDecoder : public FrameDecoder {
+public:
+    explicit DelimitedDecoder(std::vector<char> delimiter);
+
+    size_t decode(char *data, size_t len, Frame &frame) override;
+
+    void reset() override;
+
+protected:
+    //turns the payload into the frame in place, returns its size or -1 when it is malformed
+    virtual long unescape(char * /*payload*/, size_t len) {
+        return static_cast<long>(len);
+    }
+
+private:
+    std::vector<char> delimiter;
+    //bytes from the start already known to hold no complete delimiter
+    size_t scanned;
+};
+
+class DelimiterDecoder : public DelimitedDecoder {
+public:
+    explicit DelimiterDecoder(std::vector<char> delimiter);
+};
+
+class CobsDecoder : public DelimitedDecoder {
+public:
+    CobsDecoder();
+
+protected:
+    long unescape(char *payload, size_t len) override;
+};
+
+class SlipDecoder : public DelimitedDecoder {
+public:
+    SlipDecoder();
+
+protected:
+    long unescape(char *payload, size_t len) override;
+};
+
+//checks the trailing checksum of every frame another decoder finds
+class ChecksumDecoder : public FrameDecoder {
+public:
+    ChecksumDecoder(std::unique_ptr<FrameDecoder> inner, const ChecksumSpec &checksum);
+
+    size_t decode(char *data, size_t len, Frame &frame) override;
+
+    void reset() override;
+
+private:
+    std::unique_ptr<FrameDecoder> inner;
+    ChecksumSpec checksum;
+};
+
+#endif //MSERIALPORT_FRAMEDECODER_H
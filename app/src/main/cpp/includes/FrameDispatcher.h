@@ -0,0 +1,106 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_FRAMEDISPATCHER_H
+#define MSERIALPORT_FRAMEDISPATCHER_H
+
+#include <jni.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+#include "PortStats.h"
+#include "RxTimeline.h"
+
+//Hands received frames to the java listener of one port. Listeners implementing the timed
+//sub-interface of their mode (OnTimedReadListener...) get the FrameTime of every frame too.
+//Must only be used from the thread that reads the port (read thread or reactor thread),
+//except setBatchLimits() which may be called from any thread.
+class FrameDispatcher {
+public:
+    enum Mode {
+        //OnReadListener, every frame is copied into a new ByteArray
+        BYTE_ARRAY,
+        //OnDirectReadListener, one direct ByteBuffer over the receive ring is reused,
+        //so steady state delivery does not allocate on the java heap
+        DIRECT_BUFFER,
+        //OnBatchReadListener, frames are collected until max_frames or max_delay and
+        //delivered in a single upcall over a reused direct ByteBuffer and IntArray
+        BATCH
+    };
+
+    FrameDispatcher(jobject *callback, Mode mode, size_t batch_capacity);
+
+    virtual ~FrameDispatcher();
+
+    //memory a DIRECT_BUFFER listener gets a view on, every delivered frame must lie inside it
+    void setDirectRegion(char *base, size_t size);
+
+    //takes effect from the next batch
+    void setBatchLimits(int max_frames, useconds_t max_delay_us);
+
+    //timer the owner must watch for POLLIN in BATCH mode, -1 otherwise
+    int getTimerFd();
+
+    //the frame is only borrowed for the duration of the call
+    void deliver(JNIEnv *env, const char *frame, size_t len, const FrameTime &time);
+
+    //called when getTimerFd() is readable, delivers the pending batch
+    void onTimer(JNIEnv *env);
+
+    //drop the java references, env must belong to the calling thread
+    void release(JNIEnv *env);
+
+    bool hasListener();
+
+    //times every listener upcall into stats, which must outlive the dispatcher
+    void setStats(PortStats *stats);
+
+private:
+    void recordCallback(int64_t start);
+
+    void ensureDirectBuffer(JNIEnv *env);
+
+    //whether the listener wants timestamps, asked once on the first delivery
+    bool isTimed(JNIEnv *env);
+
+    void appendToBatch(JNIEnv *env, const char *frame, size_t len, const FrameTime &time);
+
+    void flushBatch(JNIEnv *env);
+
+    void arm(useconds_t us);
+
+    jobject *jcallback;
+    Mode mode;
+    PortStats *stats;
+    char *region_base;
+    size_t region_size;
+    //global ref to the reused direct ByteBuffer, created on first delivery
+    jobject direct_buffer;
+    //-1 until isTimed() asked the listener
+    int timed;
+
+    static constexpr auto DEFAULT_BATCH_FRAMES = 32;
+    static constexpr auto DEFAULT_BATCH_DELAY_US = 5000;
+    std::atomic<int> requested_max_frames;
+    std::atomic<useconds_t> requested_max_delay;
+    //limits of the batch being collected, refreshed from the requested ones when it is empty
+    int max_frames;
+    useconds_t max_delay;
+    int timer_fd;
+    std::vector<char> batch;
+    size_t batch_used;
+    //offsets[i] is where frame i starts, offsets[count] is the end of the last frame
+    std::vector<jint> offsets;
+    int batch_count;
+    //global ref, sized for max_frames + 1 entries
+    jintArray offsets_array;
+    jsize offsets_array_size;
+    //timed batches only: first read, last read and first byte time of frame i at 3 * i
+    std::vector<jlong> times;
+    //global ref, sized like times
+    jlongArray times_array;
+};
+
+#endif //MSERIALPORT_FRAMEDISPATCHER_H
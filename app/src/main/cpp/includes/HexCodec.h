@@ -0,0 +1,21 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_HEXCODEC_H
+#define MSERIALPORT_HEXCODEC_H
+
+#include <cstddef>
+
+//Decodes len hex characters (upper or lower case) into len / 2 bytes at out.
+//Returns false for an odd length or any non hex character, out may be partially written then.
+//Picks a NEON, AVX2 or SSE2 kernel when available and falls back to a lookup table.
+bool HexToBytes(const char *hex, size_t len, char *out);
+
+//Table driven reference implementation, exposed for benchmarks.
+bool HexToBytesScalar(const char *hex, size_t len, char *out);
+
+//Name of the kernel HexToBytes uses on this cpu.
+const char *HexCodecKernel();
+
+#endif //MSERIALPORT_HEXCODEC_H
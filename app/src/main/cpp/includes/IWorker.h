@@ -9,6 +9,12 @@
 #include <vector>
 #include <string>
 #include <future>
+#include <cerrno>
+#include "SerialPort.hpp"
+#include "TransactionEngine.h"
+#include "PortStats.h"
+#include "ModbusRtu.h"
+#include "CaptureLog.h"
 
 class IWorker {
 
@@ -19,6 +25,56 @@ public:
 
     virtual void doWork(const std::vector<char>& msg) = 0;
 
+    //queued writes carrying WriteFlags, workers without a write queue ignore the flags.
+    //key groups messages for WRITE_LATEST and QUEUE_COALESCE, 0 for none.
+    //Return 0 or the -errno of the first message the write queue refused
+    virtual int doWork(const std::vector<std::string> &msgs, uint32_t flags, uint64_t key) {
+        doWork(msgs);
+        return 0;
+    }
+
+    virtual int doWork(const std::vector<char> &msg, uint32_t flags, uint64_t key) {
+        doWork(msg);
+        return 0;
+    }
+
+    //OnWriteCompleteListener for WRITE_DRAIN_AFTER messages, null removes it
+    virtual void setWriteListener(JNIEnv *env, jobject listener) {}
+
+    //baud rate the driver actually runs at, -errno if unknown
+    virtual int getActualBaudRate() {
+        return -ENOTSUP;
+    }
+
+    virtual mn::CppLinuxSerial::LatencySettings getLatencySettings() {
+        return {-ENOTSUP, -1};
+    }
+
+    //fills snapshot and returns true when this worker keeps PortStats
+    virtual bool getStats(PortStats::Snapshot &snapshot) {
+        return false;
+    }
+
+    //sends request and reports the matching response to an OnTransactionListener,
+    //returns the transaction id or -errno
+    virtual int64_t submitTransaction(JNIEnv *env, std::vector<char> &&request,
+                                      ResponseMatcher &&matcher, uint32_t timeout_ms,
+                                      jobject listener) {
+        return -ENOTSUP;
+    }
+
+    //polls reads every period_ms and hands each finished cycle to an OnModbusPollListener,
+    //an empty reads list stops polling. Returns 0 or -errno
+    virtual int startModbusPolling(JNIEnv *env, std::vector<ModbusRead> &&reads,
+                                   uint32_t period_ms, uint32_t timeout_ms, jobject listener) {
+        return -ENOTSUP;
+    }
+
+    //what this worker feeds into the capture log, null when it captures nothing
+    virtual CaptureTap *getCaptureTap() {
+        return nullptr;
+    }
+
     virtual ~IWorker() {}
 
     // Request the thread to stop by setting value in promise object
@@ -0,0 +1,55 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_IDLEFRAMER_H
+#define MSERIALPORT_IDLEFRAMER_H
+
+#include <unistd.h>
+#include <atomic>
+#include "RingBuffer.h"
+
+//Cuts a frame once the line has been quiet for the configured gap.
+//Bytes are read straight into buffer() by the owner, the gap is measured by a timerfd
+//re-armed on every chunk, so the owner only has to watch getTimerFd() for POLLIN next to
+//the serial port fd. Frames are handed out in place and released after delivery.
+class IdleFramer {
+public:
+    IdleFramer(useconds_t gap_us, size_t max_frame);
+
+    virtual ~IdleFramer();
+
+    int getTimerFd();
+
+    void setGap(useconds_t gap_us);
+
+    RingBuffer &buffer();
+
+    //call after new bytes were committed to buffer(), restarts the idle timer,
+    //returns true when the frame is already full and should be taken right away
+    bool onData();
+
+    //consume the timer expiration, returns true if a frame is pending
+    bool expired();
+
+    //the pending frame, valid until release()
+    char *frame();
+
+    size_t frameSize();
+
+    //drop the delivered frame and disarm the timer
+    void release();
+
+    //drop the first n bytes of the pending frame, e.g. a response taken by a transaction,
+    //the timer is disarmed once nothing is left
+    void consume(size_t n);
+
+private:
+    void arm(useconds_t us);
+
+    int timer_fd;
+    std::atomic<useconds_t> gap;
+    RingBuffer ring;
+};
+
+#endif //MSERIALPORT_IDLEFRAMER_H
@@ -0,0 +1,58 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_JNICACHE_H
+#define MSERIALPORT_JNICACHE_H
+
+#include <jni.h>
+
+//Classes and method ids resolved once in JNI_OnLoad, so the receive path never
+//has to look them up again. The classes are kept as global refs to keep the ids valid.
+struct JniCache {
+    jclass readListenerClass;
+    //OnReadListener.onDataReceived(ByteArray)
+    jmethodID onDataReceived;
+    jclass directReadListenerClass;
+    //OnDirectReadListener.onDataReceived(ByteBuffer, Int, Int)
+    jmethodID onDirectDataReceived;
+    jclass batchReadListenerClass;
+    //OnBatchReadListener.onFramesReceived(ByteBuffer, IntArray, Int)
+    jmethodID onFramesReceived;
+    jclass timedReadListenerClass;
+    //OnTimedReadListener.onDataReceived(ByteArray, Long, Long, Long)
+    jmethodID onTimedDataReceived;
+    jclass timedDirectReadListenerClass;
+    //OnTimedDirectReadListener.onDataReceived(ByteBuffer, Int, Int, Long, Long, Long)
+    jmethodID onTimedDirectDataReceived;
+    jclass timedBatchReadListenerClass;
+    //OnTimedBatchReadListener.onFramesReceived(ByteBuffer, IntArray, Int, LongArray)
+    jmethodID onTimedFramesReceived;
+    jclass writeCompleteListenerClass;
+    //OnWriteCompleteListener.onWriteComplete(Long, Int)
+    jmethodID onWriteComplete;
+    jclass transactionListenerClass;
+    //OnTransactionListener.onTransactionComplete(Long, Int, ByteArray?)
+    jmethodID onTransactionComplete;
+    jclass modbusPollListenerClass;
+    //OnModbusPollListener.onPollCycle(Long, IntArray, IntArray, ShortArray)
+    jmethodID onPollCycle;
+    //FrameDecoder fields, read once when a port is opened
+    jclass frameDecoderClass;
+    jfieldID frameDecoderType;
+    jfieldID frameDecoderParams;
+    jfieldID frameDecoderDelimiter;
+    jfieldID frameDecoderChecksum;
+    //FrameChecksum fields
+    jclass frameChecksumClass;
+    jfieldID frameChecksumType;
+    jfieldID frameChecksumSkip;
+    jfieldID frameChecksumBigEndian;
+};
+
+extern JniCache g_jni_cache;
+
+//returns false if a class or method could not be found
+bool InitJniCache(JNIEnv *env);
+
+#endif //MSERIALPORT_JNICACHE_H
@@ -0,0 +1,87 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_MODBUSPOLLER_H
+#define MSERIALPORT_MODBUSPOLLER_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "ModbusRtu.h"
+#include "TransactionEngine.h"
+
+//Modbus RTU master side of one port: runs a list of reads, possibly across several slaves,
+//once per period. One request is on the line at a time and the next one goes out no earlier
+//than t3.5 after the previous response, both paced by a timerfd the owner watches for POLLIN.
+//Requests are sent and their responses cut as transactions of the port's TransactionEngine.
+//setSchedule() may be called from any thread, everything else from the read side.
+class ModbusPoller {
+public:
+    //results of one pass over the reads
+    struct Cycle {
+        //counts completed cycles from 1
+        uint64_t number;
+        //per read: 0, the Modbus exception code (> 0), -EBADMSG, -ETIMEDOUT, -ECANCELED or
+        //-EAGAIN when the write queue had no room for the request
+        std::vector<int> status;
+        //read i filled values [offsets[i], offsets[i + 1]), zeros unless its status is 0
+        std::vector<int> offsets;
+        std::vector<uint16_t> values;
+    };
+
+    ModbusPoller();
+
+    virtual ~ModbusPoller();
+
+    int getTimerFd();
+
+    //replaces the reads from the next cycle on, which starts right away when the poller is
+    //waiting for its period. An empty list stops polling once the current cycle is done
+    void setSchedule(std::vector<ModbusRead> reads, uint32_t period_ms, uint32_t timeout_ms,
+                     int baud);
+
+    //call when getTimerFd() is readable, returns true when request should be submitted now,
+    //the transaction id then goes to setTransaction()
+    bool onTimer(std::vector<char> &request, ResponseMatcher &matcher, uint32_t &timeout_ms);
+
+    void setTransaction(uint64_t id);
+
+    //true for the transaction of the request on the line
+    bool owns(uint64_t id);
+
+    //returns true when the result completed a cycle, cycle() holds it until the next result
+    bool onResult(const TransactionEngine::Result &result);
+
+    const Cycle &cycle();
+
+private:
+    void arm(int64_t delay_ns);
+
+    static int64_t now();
+
+    int timer_fd;
+    //guards the requested schedule
+    std::mutex mutex;
+    bool changed;
+    std::vector<ModbusRead> next_reads;
+    uint32_t next_period_ms;
+    uint32_t next_timeout_ms;
+    int next_baud;
+    //read side
+    std::vector<ModbusRead> reads;
+    uint32_t period_ms;
+    uint32_t timeout_ms;
+    ModbusTiming timing;
+    //next read of the cycle, 0 between cycles
+    size_t index;
+    //transaction on the line, 0 for none
+    uint64_t awaiting;
+    int64_t cycle_start_ns;
+    //t3.5 after the last response, the next request may not go out earlier
+    int64_t gap_end_ns;
+    int64_t next_cycle_ns;
+    Cycle current;
+};
+
+#endif //MSERIALPORT_MODBUSPOLLER_H
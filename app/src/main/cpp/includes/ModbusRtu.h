@@ -0,0 +1,61 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_MODBUSRTU_H
+#define MSERIALPORT_MODBUSRTU_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Modbus RTU framing, after "MODBUS over serial line specification V1.02"
+
+//read functions the poller supports, the values match SerialPortManager.MODBUS_* on the java side
+enum ModbusFunction : uint8_t {
+    MODBUS_READ_COILS = 1,
+    MODBUS_READ_DISCRETE_INPUTS = 2,
+    MODBUS_READ_HOLDING_REGISTERS = 3,
+    MODBUS_READ_INPUT_REGISTERS = 4,
+};
+
+struct ModbusRead {
+    uint8_t slave;
+    uint8_t function;
+    uint16_t address;
+    //registers, or coils/inputs, to read
+    uint16_t count;
+};
+
+//silent intervals on the line, in microseconds
+struct ModbusTiming {
+    //one character, 11 bits in RTU mode whatever the parity
+    uint32_t char_us;
+    //longest gap allowed inside a frame
+    uint32_t t1_5_us;
+    //shortest gap between two frames
+    uint32_t t3_5_us;
+};
+
+//above 19200 baud the specification fixes t1.5 at 750us and t3.5 at 1750us,
+//baud <= 0 (unknown) gets those as well
+ModbusTiming ModbusTimingFor(int baud);
+
+//CRC-16/MODBUS, it goes on the wire low byte first
+uint16_t ModbusCrc16(const char *data, size_t len);
+
+//slave 1..247, a supported function and a count the response can hold
+bool ModbusValidRead(const ModbusRead &read);
+
+std::vector<char> ModbusBuildRead(const ModbusRead &read);
+
+//size of the response to read at the start of data, 0 while it is incomplete.
+//Bytes that cannot start that response are taken whole, they then fail to parse instead of
+//holding the port until the deadline
+size_t ModbusResponseSize(const ModbusRead &read, const char *data, size_t len);
+
+//0 and read.count values written to values (coils as 0/1), the exception code (> 0)
+//when the slave refused, or -EBADMSG for a corrupt frame or one that answers something else
+int ModbusParseRead(const ModbusRead &read, const char *data, size_t len, uint16_t *values);
+
+#endif //MSERIALPORT_MODBUSRTU_H
@@ -0,0 +1,125 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_PORTSTATS_H
+#define MSERIALPORT_PORTSTATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+//Log-linear histogram in the spirit of HdrHistogram: every power of two is split into
+//SUB_BUCKETS linear buckets, so any value is recorded within 1/SUB_BUCKETS of itself.
+//record() is a couple of relaxed atomic adds, any thread may record and snapshot at once.
+class LatencyHistogram {
+public:
+    struct Snapshot {
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+        uint64_t p50;
+        uint64_t p90;
+        uint64_t p99;
+        uint64_t p999;
+    };
+
+    LatencyHistogram();
+
+    void record(uint64_t value);
+
+    //percentiles are the upper bound of their bucket, clamped to max
+    Snapshot snapshot() const;
+
+private:
+    static constexpr unsigned SUB_BUCKET_BITS = 3;
+    static constexpr unsigned SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static size_t bucketOf(uint64_t value);
+
+    static uint64_t upperBound(size_t bucket);
+
+    std::atomic<uint64_t> buckets[BUCKET_COUNT];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+};
+
+//Counters and latency histograms of one port. Lock-free, the read side, the write side and
+//java callers all update it directly, getPortStats() snapshots it without stopping anyone.
+class PortStats {
+public:
+    //the order is the layout of SerialPortManager.getPortStats() on the java side
+    enum Counter {
+        BYTES_IN,
+        BYTES_OUT,
+        FRAMES_IN,
+        FRAMES_OUT,
+        READ_CALLS,
+        WRITE_CALLS,
+        //writev() calls the driver accepted only part of
+        SHORT_WRITES,
+        //most messages ever waiting in the write queue at once
+        QUEUE_HIGH_WATER,
+        //received frames nobody took and outgoing messages that were never sent
+        DROPPED_FRAMES,
+        //settings changed at runtime through commands
+        RECONFIGURATIONS,
+        //messages the write queue policy refused or dropped to make room
+        QUEUE_REJECTIONS,
+        //queued messages replaced by a newer one with the same key
+        QUEUE_COALESCED,
+        COUNTER_COUNT
+    };
+
+    //all in nanoseconds
+    enum Histogram {
+        //enqueue until the last byte went to the driver
+        QUEUE_WAIT,
+        //read() and writev() on the port
+        SYSCALL_TIME,
+        //java listener upcalls
+        CALLBACK_TIME,
+        HISTOGRAM_COUNT
+    };
+
+    struct Snapshot {
+        uint64_t counters[COUNTER_COUNT];
+        LatencyHistogram::Snapshot histograms[HISTOGRAM_COUNT];
+    };
+
+    PortStats();
+
+    void add(Counter counter, uint64_t n = 1) {
+        counters[counter].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    //raises the counter to value if it is higher
+    void raise(Counter counter, uint64_t value);
+
+    void record(Histogram histogram, uint64_t ns) {
+        histograms[histogram].record(ns);
+    }
+
+    Snapshot snapshot() const;
+
+    //monotonic clock the histograms are recorded on
+    static int64_t now() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+private:
+    //read side and write side counters are bumped by different threads
+    struct alignas(64) PaddedCounter {
+        std::atomic<uint64_t> value;
+    };
+
+    PaddedCounter counters[COUNTER_COUNT];
+    LatencyHistogram histograms[HISTOGRAM_COUNT];
+};
+
+#endif //MSERIALPORT_PORTSTATS_H
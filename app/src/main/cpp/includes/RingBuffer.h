@@ -0,0 +1,64 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_RINGBUFFER_H
+#define MSERIALPORT_RINGBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+
+//Byte ring that is filled by read() directly and consumed in place.
+//When the kernel supports memfd the same pages are mapped twice back to back, so both the
+//readable and the writable region are always one contiguous span, wrap-around included.
+//Otherwise it falls back to a flat buffer that is compacted once the tail hits the end.
+//Single threaded: the producer and the consumer must run on the same thread.
+class RingBuffer {
+public:
+    //capacity is rounded up to whole pages
+    explicit RingBuffer(size_t capacity);
+
+    virtual ~RingBuffer();
+
+    RingBuffer(const RingBuffer &) = delete;
+
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    //free space, read() into writePtr() then commit() what was filled
+    char *writePtr();
+
+    size_t writable();
+
+    void commit(size_t n);
+
+    //received bytes not consumed yet, the consumer may rewrite them in place (frame decoders)
+    char *readPtr();
+
+    size_t readable();
+
+    void consume(size_t n);
+
+    void clear();
+
+    //stream offset of readPtr(): every byte ever consumed or cleared, never reset
+    uint64_t position();
+
+    size_t capacity();
+
+    //start of the mapping, readPtr() is always within [base(), base() + 2 * capacity())
+    char *base();
+
+    bool isMirrored();
+
+private:
+    bool mapMirrored();
+
+    char *mem;
+    size_t cap;
+    size_t head;
+    size_t tail;
+    uint64_t consumed;
+    bool mirrored;
+};
+
+#endif //MSERIALPORT_RINGBUFFER_H
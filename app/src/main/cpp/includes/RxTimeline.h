@@ -0,0 +1,65 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_RXTIMELINE_H
+#define MSERIALPORT_RXTIMELINE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//when the bytes of one delivered frame came in, CLOCK_MONOTONIC_RAW nanoseconds
+struct FrameTime {
+    //right after the read() that returned the first byte of the frame, 0 when unknown
+    int64_t first_read_ns = 0;
+    //right after the read() that returned its last byte
+    int64_t last_read_ns = 0;
+    //estimated arrival of the first byte at the UART, 0 unless estimation is on
+    int64_t first_byte_ns = 0;
+};
+
+//Receive times of the bytes in a port's ring. Every read() leaves a mark keyed by the stream
+//position (RingBuffer::position()) its bytes end at, so a frame is stamped from the reads it
+//came from however framing, decoders or transactions consumed the bytes before it.
+//Read side only, except setCharTime().
+class RxTimeline {
+public:
+    RxTimeline();
+
+    //the clock every mark uses, not slewed by NTP so intervals stay true to the wire
+    static int64_t now();
+
+    //time one character takes on the wire, 0 turns first byte estimation off
+    void setCharTime(uint32_t char_ns);
+
+    //true when the owner should pass how many bytes the driver still holds after a read
+    bool estimating();
+
+    //len bytes ending at stream position end were read at read_ns, pending more were
+    //already queued behind them in the driver
+    void onChunk(uint64_t end, size_t len, int64_t read_ns, size_t pending);
+
+    //stamps the bytes [start, start + len), marks of bytes before start are forgotten
+    FrameTime stamp(uint64_t start, size_t len);
+
+private:
+    struct Mark {
+        uint64_t begin;
+        uint64_t end;
+        int64_t read_ns;
+        //estimated arrival of the byte at begin, 0 when not estimated
+        int64_t first_byte_ns;
+    };
+
+    const Mark &at(size_t i);
+
+    //a frame spanning more reads than this is stamped from the oldest one kept
+    static constexpr size_t MAX_MARKS = 256;
+    Mark marks[MAX_MARKS];
+    size_t first;
+    size_t count;
+    std::atomic<uint32_t> char_ns;
+};
+
+#endif //MSERIALPORT_RXTIMELINE_H
@@ -7,13 +7,40 @@
 
 #include "../includes/IWorker.h"
 #include "SerialPort.hpp"
+#include "SerialPortReactor.h"
+#include "IdleFramer.h"
+#include "SerialWriter.h"
+#include "FrameDispatcher.h"
+#include "TransactionEngine.h"
+#include "PortStats.h"
+#include "FrameDecoder.h"
+#include "ModbusPoller.h"
+#include "RxTimeline.h"
 #include <unistd.h>
-#include <queue>
 #include <poll.h>
+#include <sys/eventfd.h>
+#include <unordered_map>
 
 using namespace mn::CppLinuxSerial;
 static constexpr auto START_READ = "start_read";
 static constexpr auto SET_READ_INTERVAL = "read_interval:";
+static constexpr auto SET_READ_BUFFER_SIZE = "read_buffer_size:";
+//followed by "<max frames>,<max delay us>"
+static constexpr auto SET_BATCH_DELIVERY = "batch_delivery:";
+//followed by the number of requests that may await a response at once
+static constexpr auto SET_TRANSACTION_WINDOW = "transaction_window:";
+//followed by 1 or 0, see SerialPort::SetLowLatency
+static constexpr auto SET_LOW_LATENCY = "low_latency:";
+//followed by "<max messages>,<max bytes>,<QueuePolicy>"
+static constexpr auto SET_WRITE_QUEUE = "write_queue:";
+//followed by the chunk size in bytes, see SerialWriter::setChunkSize
+static constexpr auto SET_WRITE_CHUNK = "write_chunk:";
+//followed by 1 or 0, estimates the arrival of every frame's first byte from FIONREAD and the
+//baud rate, at the cost of one ioctl per read
+static constexpr auto SET_FIRST_BYTE_ESTIMATE = "first_byte_estimate:";
+//queues an empty WRITE_DRAIN_AFTER message, the write listener hears back once everything
+//queued before it has left the UART
+static constexpr auto FLUSH = "flush";
 
 class SPReadWriteWorker : public IWorker {
 
@@ -67,41 +94,152 @@ class SPReadWriteWorker : public IWorker {
 
     void readLoop();
 
+    //starts the read thread, or read interest in reactor mode, at most once
+    void startReading();
+
     void stop() override {
-        const std::lock_guard<std::mutex> lock(m_mutex);
         IWorker::stop();
-        cv.notify_all();
+        writer.close();
+        eventfd_write(stop_event_fd, 1);
     }
 
     void writeLoop();
 
+    //read side handlers, called on the read thread or the shared reactor thread.
+    //onReadable returns false once the device hung up or the read failed, every later
+    //read would do the same
+    bool onReadable(JNIEnv *callEnv);
 
-private:
-    void writeMessage(const std::vector<std::string> &messages);
+    //the port is gone: hands out what was received, fails what waits for an answer
+    //and refuses further writes
+    void onHangup(JNIEnv *callEnv);
+
+    void onIdleTimeout(JNIEnv *callEnv);
+
+    //reactor mode, the port fd carries both read and write readiness.
+    //A hangup takes the port fd out of the reactor
+    void onPortEvent(uint32_t events);
+
+    void setWriteBlocked(bool blocked);
+
+    //call with interest_mutex held
+    void updateInterest();
+
+    void emitFrame(JNIEnv *callEnv);
+
+    //hands every complete frame the decoder finds in the ring to the dispatcher
+    void decodeFrames(JNIEnv *callEnv);
+
+    void onBatchTimeout(JNIEnv *callEnv);
+
+    void onTransactionTimeout(JNIEnv *callEnv);
+
+    //hands received bytes to waiting transactions, returns true while responses are still expected
+    bool matchResponses(JNIEnv *callEnv);
+
+    //calls and releases the listeners of finished transactions
+    void deliverResults(JNIEnv *callEnv);
+
+    //sends the next poll request once the poller's gap or period is over
+    void onModbusTimer();
+
+    //hands a finished poll cycle to the java listener in one call
+    void deliverModbusCycle(JNIEnv *callEnv);
 
+    //writer side, forwards a WRITE_DRAIN_AFTER completion to the java listener
+    void notifyWriteComplete(uint64_t sequence, int error);
+
+
+private:
     //instance of promise/future pair that is used for messaging
     static constexpr auto DEFAULT_TIME_INTERVAL = 500;
-    useconds_t custom_read_interval;
-    std::mutex m_mutex;
-    std::thread* loop_thread;
-    std::atomic<bool> data_available;
+    //declared ahead of everything that records into it
+    PortStats stats;
+    //staging buffers of the capture log, idle until it captures this port
+    CaptureTap capture;
+    //cuts frames once the line has been quiet for the read interval,
+    //bytes are read straight into its ring and delivered from there
+    IdleFramer framer;
+    //null unless the port was opened with a frame decoder, which then replaces idle framing
+    std::unique_ptr<FrameDecoder> decoder;
+    //when the bytes in the framer's ring were read, stamps every delivered frame
+    RxTimeline timeline;
+    FrameDispatcher dispatcher;
+    //wakes the read and write threads out of poll when stopping
+    int stop_event_fd;
     std::thread *read_thread;
     std::thread *write_thread;
-    std::queue<std::vector<std::string>> mMessages;
-    std::queue<std::vector<char>> mByteMessages;
     JavaVM *g_vm;
-    jobject *jcallback;
     JNIEnv *env;
     SerialPort *_serialPort;
-    std::condition_variable cv;
+    //null when this worker runs its own read/write threads
+    SerialPortReactor *reactor;
+    static constexpr auto WRITE_QUEUE_MAX_MESSAGES = 256;
+    static constexpr auto WRITE_QUEUE_MAX_BYTES = 1024 * 1024;
+    SerialWriter writer;
+    TransactionEngine transactions;
+    //read side scratch space for finished transactions
+    std::vector<TransactionEngine::Result> results;
+    //guards transaction_listeners, held across submit so a fast response finds its listener
+    std::mutex transaction_mutex;
+    std::unordered_map<uint64_t, jobject> transaction_listeners;
+    //polls run as transactions, their results never reach transaction_listeners
+    ModbusPoller modbus;
+    //guards modbus_listener, which java threads swap while the read side calls it,
+    //not held during the call so the listener may reschedule or stop polling
+    std::mutex modbus_mutex;
+    jobject modbus_listener;
+    //global refs handed to modbus_listener every cycle, resized when the poll list changes
+    jintArray modbus_status;
+    jintArray modbus_offsets;
+    jshortArray modbus_values;
+    std::atomic<bool> read_started;
+    //reactor mode epoll interest of the port fd, touched by java threads and the reactor thread
+    std::mutex interest_mutex;
+    std::atomic<bool> reading;
+    bool write_blocked;
+    //the port fd was taken out of the reactor after a hangup, guarded by interest_mutex
+    bool port_removed;
+    //guards write_listener, which java threads swap while the writer side calls it
+    std::mutex listener_mutex;
+    jobject write_listener;
+    //write thread's env, the reactor thread's is used in reactor mode
+    JNIEnv *write_env;
 public:
-    SPReadWriteWorker(std::string &name, const int &baudrate, JavaVM *vm, jobject *callback);
+    //frames longer than this are cut even without a gap, or dropped by a frame decoder
+    static constexpr size_t MAX_FRAME_SIZE = 64 * 1024;
+
+    SPReadWriteWorker(std::string &name, const int &baudrate, JavaVM *vm, jobject *callback,
+                      SerialPortReactor *reactor = nullptr,
+                      FrameDispatcher::Mode mode = FrameDispatcher::BYTE_ARRAY,
+                      const FrameDecoderSpec &decoderSpec = FrameDecoderSpec());
 
     virtual ~SPReadWriteWorker();
 
     void doWork(const std::vector<std::string> &msgs) override;
 
     virtual void doWork(const std::vector<char> &msgs) override;
+
+    int doWork(const std::vector<std::string> &msgs, uint32_t flags, uint64_t key) override;
+
+    int doWork(const std::vector<char> &msg, uint32_t flags, uint64_t key) override;
+
+    void setWriteListener(JNIEnv *callEnv, jobject listener) override;
+
+    int getActualBaudRate() override;
+
+    LatencySettings getLatencySettings() override;
+
+    bool getStats(PortStats::Snapshot &snapshot) override;
+
+    CaptureTap *getCaptureTap() override;
+
+    int64_t submitTransaction(JNIEnv *callEnv, std::vector<char> &&request,
+                              ResponseMatcher &&matcher, uint32_t timeout_ms,
+                              jobject listener) override;
+
+    int startModbusPolling(JNIEnv *callEnv, std::vector<ModbusRead> &&reads, uint32_t period_ms,
+                           uint32_t timeout_ms, jobject listener) override;
 };
 
 
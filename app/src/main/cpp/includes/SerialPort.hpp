@@ -17,9 +17,12 @@
 #include <sstream>
 #include <androidLog.h>
 #include <termios.h> // POSIX terminal control definitions (struct termios)
+#include <sys/uio.h> // struct iovec
 #include <vector>
+#include <atomic>
 
 // User headers
+#include "RingBuffer.h"
 
 namespace mn {
     namespace CppLinuxSerial {
@@ -66,11 +69,30 @@ namespace mn {
             OPEN
         };
 
+        /// \brief      Latency related settings as the kernel reports them.
+        struct LatencySettings {
+            /// \brief  1 if ASYNC_LOW_LATENCY is set, 0 if not, -errno if the driver has no TIOCGSERIAL.
+            int lowLatency;
+            /// \brief  FTDI latency_timer in ms, -1 if the device is not an FTDI adapter.
+            int latencyTimer_ms;
+        };
+
+        /// \brief      How a new configuration is applied to an open port.
+        struct ConfigureOptions {
+            /// \brief  Discard received but unread bytes before applying (tcflush TCIFLUSH).
+            bool flushInput = true;
+            /// \brief  Sleep this long before applying, for adapters that need the line to settle. 0 skips it.
+            uint32_t settleDelay_us = 0;
+        };
+
 
 /// \brief		SerialPort object is used to perform rx/tx serial communication.
         class SerialPort {
 
         public:
+            /// \brief      Largest value accepted by SetReadBufferSize().
+            static constexpr size_t maxReadBufferSize_B_ = 64 * 1024;
+
             int getFileDescriptor();
 
             /// \brief		Default constructor. You must specify at least the device before calling Open().
@@ -89,8 +111,14 @@ namespace mn {
             /// \details    Method can be called when serial port is in any state.
             void SetDevice(const std::string &device);
 
+            /// \brief      Any positive rate, rates without a Bxxx constant are set through termios2/BOTHER.
+            /// \throws     CppLinuxSerial::Exception if baudRate <= 0.
             void SetBaudRate(int baudRate);
 
+            /// \brief      The rate the driver actually runs at, which may be rounded from the requested one.
+            /// \return     The rate, or -errno if it cannot be queried (e.g. port not open).
+            int GetActualBaudRate();
+
             /// \brief      Sets the read timeout (in milliseconds)/blocking mode.
             /// \details    Only call when state != OPEN. This method manupulates VMIN and VTIME.
             /// \param      timeout_ms  Set to -1 to infinite timeout, 0 to return immediately with any data (non
@@ -99,10 +127,38 @@ namespace mn {
             ///             25500ms (another Linux API restriction).
             void SetTimeout(int32_t timeout_ms);
 
+            /// \brief      Sets how many bytes a single read() syscall may return.
+            /// \details    Method can be called when serial port is in any state.
+            /// \throws     CppLinuxSerial::Exception if size is 0 or larger than maxReadBufferSize_B_.
+            void SetReadBufferSize(size_t size);
+
+            size_t GetReadBufferSize();
+
+            /// \brief      Opens the port with O_NONBLOCK, read() and write() never sleep.
+            /// \details    Only call when state != OPEN. The blocking Write() overloads still wait
+            ///             for POLLOUT internally, use WriteSome() to handle EAGAIN yourself.
+            void SetNonBlocking(bool value);
+
             /// \brief		Enables/disables echo.
             /// \param		value		Pass in true to enable echo, false to disable echo.
             void SetEcho(bool value);
 
+            /// \brief      Asks the driver to push received bytes up without buffering (ASYNC_LOW_LATENCY),
+            ///             and for FTDI adapters lowers the sysfs latency_timer to 1 ms (16 ms when disabled).
+            /// \details    Method can be called when serial port is in any state, it is applied on Open().
+            ///             Drivers without support are logged and left as they are, see GetLatencySettings().
+            void SetLowLatency(bool value);
+
+            /// \brief      Reads back the effective latency settings of the open port.
+            LatencySettings GetLatencySettings();
+
+            /// \brief      Options used whenever Open(), SetBaudRate(), SetDevice() or SetEcho() reconfigure the port.
+            void SetConfigureOptions(const ConfigureOptions &options);
+
+            /// \brief      Sets baud rate and echo together, an open port is reconfigured once.
+            /// \details    tcsetattr() is skipped when the resulting termios equals the current one.
+            void Configure(int baudRate, bool echo, const ConfigureOptions &options);
+
             /// \brief		Opens the COM port for use.
             /// \throws		CppLinuxSerial::Exception if device cannot be opened.
             /// \note		Must call this before you can configure the COM port.
@@ -119,9 +175,41 @@ namespace mn {
             /// \brief		Sends a message over the com port.
             /// \bytes		bytes		The data that will be written to the COM port.
             /// \len		bytes		Length of bytes to send
+            /// \details    Returns once the driver took everything, it does not wait for the UART (see Drain()).
             /// \throws		CppLinuxSerial::Exception if state != OPEN.
             void Write(char *bytes, int len);
 
+            /// \brief		Sends several buffers with as few writev() calls as possible, without tcdrain.
+            /// \details    Short writes, EINTR and EAGAIN are retried until everything is out.
+            /// \param		iov		    Buffers to send, entries are advanced in place as bytes go out.
+            /// \param		count		Number of entries in iov, at most IOV_MAX.
+            /// \throws		CppLinuxSerial::Exception if state != OPEN, std::system_error on write errors.
+            void Write(struct iovec *iov, int count);
+
+            /// \brief		A single writev(), EINTR is retried.
+            /// \return		Bytes written, 0 if the port would block, -errno on any other error.
+            ssize_t WriteSome(const struct iovec *iov, int count);
+
+            /// \brief		Blocks until everything written so far has left the UART (tcdrain).
+            /// \return		0 on success, otherwise the errno of tcdrain().
+            int Drain();
+
+            /// \brief		Bytes written but not yet sent by the driver (TIOCOUTQ), never blocks.
+            /// \return		The byte count, or -errno.
+            int OutputPending();
+
+            /// \brief		Bytes received by the driver but not read yet (FIONREAD), never blocks.
+            /// \return		The byte count, or -errno.
+            int InputPending();
+
+            /// \brief		Bits one character takes on the wire: start, data, parity and stop bits.
+            /// \return		The bit count, 10 (8N1) when the attributes cannot be read.
+            int CharacterBits();
+
+            /// \brief		Discards received bytes that have not been read yet (tcflush TCIFLUSH).
+            /// \return		0 on success, otherwise errno.
+            int FlushInput();
+
             /// \brief		Use to read from the COM port.
             /// \param		data		The object the read characters from the COM port will be saved to.
             /// \param      wait_ms     The amount of time to wait for data. Set to 0 for non-blocking mode. Set to -1
@@ -129,6 +217,22 @@ namespace mn {
             /// \throws		CppLinuxSerial::Exception if state != OPEN.
             void Read(std::string &data);
 
+            /// \brief		Reads straight into caller owned memory, no intermediate copy or allocation.
+            /// \param		buffer		Where the received bytes are written to.
+            /// \param		capacity	Free space at buffer, at most GetReadBufferSize() bytes are read.
+            /// \param		hangup		Optional, set to true when read() returned 0, i.e. the device hung up.
+            /// \return		Number of bytes read, 0 if nothing was available.
+            /// \throws		CppLinuxSerial::Exception if state != OPEN.
+            /// \throws		std::system_error on read errors other than EAGAIN, e.g. EIO once the device is gone.
+            size_t Read(char *buffer, size_t capacity, bool *hangup = nullptr);
+
+            /// \brief		Reads straight into the free region of ring and commits what was received,
+            ///             so frame parsers and the JNI bridge can use the bytes in place.
+            /// \param		hangup		Optional, see Read(), left untouched when ring is full.
+            /// \return		Number of bytes read, 0 if nothing was available or ring is full.
+            /// \throws		CppLinuxSerial::Exception if state != OPEN.
+            size_t ReadInto(RingBuffer &ring, bool *hangup = nullptr);
+
             State currendState();
 
         private:
@@ -138,9 +242,15 @@ namespace mn {
 
             /// \brief		Configures the tty device as a serial port.
             /// \warning    Device must be open (valid file descriptor) when this is called.
-            void ConfigureTermios();
+            void ConfigureTermios(const ConfigureOptions &options);
+
+            void ApplyLowLatency();
+
+            /// \brief		sysfs latency_timer of an FTDI device, empty if device_ is something else.
+            std::string LatencyTimerPath();
 
-            void SetTermios(termios myTermios);
+            /// \brief		Applies tty unless it equals current, returns whether tcsetattr() was called.
+            bool SetTermios(const termios &tty, const termios &current, const ConfigureOptions &options);
 
             /// \brief      Keeps track of the serial port's state.
             State state_;
@@ -156,13 +266,19 @@ namespace mn {
 
             bool echo_;
 
+            bool nonBlocking_;
+
+            bool lowLatency_;
+
             int32_t timeout_ms_;
 
-            std::vector<char> readBuffer_;
-            unsigned char readBufferSize_B_;
+            ConfigureOptions configureOptions_;
+
+            /// \brief      Upper bound for a single read() syscall, may change while another thread reads.
+            std::atomic<size_t> readBufferSize_B_;
 
             static constexpr int32_t defaultTimeout_ms_ = -1;
-            static constexpr unsigned char defaultReadBufferSize_B_ = 255;
+            static constexpr size_t defaultReadBufferSize_B_ = 4096;
 
 
         };
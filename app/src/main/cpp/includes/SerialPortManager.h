@@ -5,13 +5,17 @@
 #ifndef MSERIALPORT_SERIALPORTMANAGER_H
 #define MSERIALPORT_SERIALPORTMANAGER_H
 
+#include <functional>
 #include <unordered_map>
 #include <SPWriteWorker.h>
 #include <SPReadWorker.h>
+#include <SerialPortReactor.h>
 #include <androidLog.h>
 
 class SerialPortManager {
 public:
+    using WorkerFactory = std::function<std::unique_ptr<IWorker>()>;
+
     explicit SerialPortManager();
 
     virtual ~SerialPortManager();
@@ -19,19 +23,69 @@ public:
     bool hasSerialPort(std::string path);
 
     int addSerialPort(const char *path, std::unique_ptr<IWorker> worker) {
+        retire(std::move(inner_map[path]));
+        if (worker->getCaptureTap() != nullptr)
+            capture.attach(path, worker->getCaptureTap());
         inner_map[path] = std::move(worker);
         LOGD("添加串口%s", path);
         return 0;
     }
 
+    //builds the workers concurrently, opening and configuring a port is mostly waiting on the driver.
+    //Ports whose worker fails to build are logged and skipped, returns how many were added
+    int addSerialPorts(std::vector<std::pair<std::string, WorkerFactory>> ports);
+
     int removeSerialPort(std::string path);
 
-    int sendMessage(std::string path, const std::vector<std::string> &msg);
+    //0, -ENODEV when the port is not open, or the -errno the write queue refused a message with
+    int sendMessage(std::string path, const std::vector<std::string> &msg, uint32_t flags = 0,
+                    uint64_t key = 0);
+
+    int sendBytesMessage(std::string path, const std::vector<char> &msg, uint32_t flags = 0,
+                         uint64_t key = 0);
+
+    int setWriteListener(std::string path, JNIEnv *env, jobject listener);
+
+    //-ENODEV when the port is not open
+    int getActualBaudRate(std::string path);
+
+    //returns the transaction id, or -errno (-ENODEV when the port is not open)
+    int64_t submitTransaction(std::string path, JNIEnv *env, std::vector<char> &&request,
+                              ResponseMatcher &&matcher, uint32_t timeout_ms, jobject listener);
+
+    //0, or -errno (-ENODEV when the port is not open)
+    int startModbusPolling(std::string path, JNIEnv *env, std::vector<ModbusRead> &&reads,
+                           uint32_t period_ms, uint32_t timeout_ms, jobject listener);
 
-    int sendBytesMessage(std::string path, const std::vector<char> &msg);
+    //lowLatency is -ENODEV when the port is not open
+    mn::CppLinuxSerial::LatencySettings getLatencySettings(std::string path);
+
+    //0 on success, -ENODEV when the port is not open, -ENOTSUP when its worker keeps no stats
+    int getPortStats(std::string path, PortStats::Snapshot &snapshot);
+
+    //records the traffic of port, or of every port when it is empty, into segment files in dir.
+    //0 or -errno, see CaptureLog::start
+    int startCapture(const std::string &dir, size_t segment_bytes, int max_segments,
+                     const std::string &port);
+
+    void stopCapture();
+
+    //ports opened after enabling share a single epoll thread instead of running their own
+    void setReactorMode(bool enabled);
+
+    //returns the shared reactor when reactor mode is on, creating it lazily, otherwise null
+    SerialPortReactor *getReactor(JavaVM *vm);
 
 private:
+    //detaches worker from the capture and destroys it. On the reactor thread, where a listener
+    //may close its own port, that waits until the handler on the stack has returned
+    void retire(std::unique_ptr<IWorker> worker);
+
+    bool reactor_mode = false;
+    std::unique_ptr<SerialPortReactor> reactor;
     std::unordered_map<std::string, std::unique_ptr<IWorker>> inner_map;
+    //the capture taps of the workers in inner_map are attached for as long as they live
+    CaptureLog capture;
 
 };
 
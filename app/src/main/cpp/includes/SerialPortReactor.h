@@ -0,0 +1,70 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_SERIALPORTREACTOR_H
+#define MSERIALPORT_SERIALPORTREACTOR_H
+
+#include <jni.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//One epoll loop shared by every port opened in reactor mode.
+//Handlers run on the reactor thread, which is attached to the JVM for its whole lifetime,
+//so they may call back into java with getEnv(). Handlers must never block. No lock is held while
+//they run, so adding and removing other fds never waits for a slow java listener.
+class SerialPortReactor {
+public:
+    using Handler = std::function<void(uint32_t events)>;
+
+    explicit SerialPortReactor(JavaVM *vm);
+
+    virtual ~SerialPortReactor();
+
+    //register fd with the given epoll events, returns 0 on success or -errno
+    int add(int fd, uint32_t events, Handler handler);
+
+    int modify(int fd, uint32_t events);
+
+    //unregister fd, once this returns the handler is guaranteed not to be running,
+    //except when called from the loop thread, e.g. by the handler itself
+    int remove(int fd);
+
+    //loop thread only, runs task once the current dispatch round is over. For destroying
+    //what a handler still on the stack belongs to
+    void defer(std::function<void()> task);
+
+    //only valid on the reactor thread
+    JNIEnv *getEnv();
+
+    bool inLoopThread();
+
+private:
+    void loop();
+
+    static constexpr auto MAX_EVENTS = 64;
+    int epoll_fd;
+    //eventfd used to break epoll_wait when the reactor is shutting down
+    int wake_fd;
+    std::atomic<bool> running;
+    //guards handlers and the round state, never held while a handler runs
+    std::mutex m_mutex;
+    std::unordered_map<int, std::shared_ptr<Handler>> handlers;
+    //a round may still call a handler it looked up before remove(), which waits for its end
+    std::condition_variable round_done;
+    bool dispatching;
+    uint64_t rounds;
+    std::vector<std::function<void()>> deferred;
+    std::thread *loop_thread;
+    JavaVM *g_vm;
+    JNIEnv *env;
+};
+
+#endif //MSERIALPORT_SERIALPORTREACTOR_H
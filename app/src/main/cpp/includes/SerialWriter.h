@@ -0,0 +1,174 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_SERIALWRITER_H
+#define MSERIALPORT_SERIALWRITER_H
+
+#include <sys/uio.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "SerialPort.hpp"
+#include "SpscQueue.h"
+#include "PortStats.h"
+#include "WriteQueue.h"
+#include "CaptureLog.h"
+
+//Outgoing side of one port. Java threads enqueue, a single writer (the port's write thread or
+//the reactor thread) drains the queue and submits everything pending in one writev().
+//The queue is bounded, what happens to messages beyond its limits follows its QueuePolicy.
+class SerialWriter {
+public:
+    //called on the writer side for every message that could not be sent, with the real errno
+    using ErrorHandler = std::function<void(const WriteMessage &message, int error)>;
+    //called on the writer side when a WRITE_DRAIN_AFTER message has been transmitted,
+    //or with the errno that kept it from being sent
+    using CompletionHandler = std::function<void(uint64_t sequence, int error)>;
+
+    SerialWriter(mn::CppLinuxSerial::SerialPort *port, size_t max_messages, size_t max_bytes);
+
+    virtual ~SerialWriter();
+
+    //readable when there is something to write, watch it for POLLIN
+    int getEventFd();
+
+    //readable while WRITE_DRAIN_AFTER messages wait for the UART, watch it for POLLIN
+    int getTimerFd();
+
+    //producer side, an empty buffer that keeps the capacity of a previously sent message
+    std::vector<char> acquireBuffer();
+
+    //producer side, returns 0 once queued, -EAGAIN when the queue policy refused it,
+    //-EPIPE once stopped. Under QUEUE_BLOCK it waits while the queue is full, without holding
+    //up other producers of a queue that has room
+    int enqueue(WriteMessage &&message);
+
+    //same as enqueue but never waits, a full queue is -EAGAIN under QUEUE_BLOCK too.
+    //For callers on the read or reactor thread, which must not sleep on the writer
+    int tryEnqueue(WriteMessage &&message);
+
+    //any thread, see WriteQueue::setLimits
+    void setQueueLimits(size_t max_messages, size_t max_bytes, QueuePolicy policy);
+
+    //any thread. Messages larger than chunk_size bytes are written chunk by chunk and give way
+    //to WRITE_PRIORITY messages between chunks, smaller ones are batched up to one chunk.
+    //0 (the default) turns chunking off
+    void setChunkSize(size_t chunk_size);
+
+    //any thread, wakes producers waiting for room and refuses later messages. The writer fails
+    //what is left like stop() on its next event
+    void close();
+
+    //writer side, close() and fails every message not sent yet with EPIPE through the error
+    //handler, WRITE_DRAIN_AFTER ones and those still waiting for the UART through the
+    //completion handler
+    void stop();
+
+    void setErrorHandler(ErrorHandler handler);
+
+    void setCompletionHandler(CompletionHandler handler);
+
+    //counts the write side into stats, which must outlive the writer. Set before the first enqueue
+    void setStats(PortStats *stats);
+
+    //stages every byte the driver accepts into capture while it is enabled, must outlive the
+    //writer. Set before the first enqueue
+    void setCapture(CaptureChannel *capture);
+
+    //writer side, called when getEventFd() is readable.
+    //Returns true when the port would block, the caller then watches it for POLLOUT
+    bool onEvent();
+
+    //writer side, called on POLLOUT while blocked, same return value as onEvent()
+    bool onWritable();
+
+    //writer side, called when getTimerFd() is readable
+    void onTimer();
+
+private:
+    enum Progress {
+        EMPTY,
+        WROTE,
+        BLOCKED
+    };
+
+    //writes until the queue is empty or the port would block
+    bool pump();
+
+    //writes the current batch, or the next one when it is done.
+    //A batch cut short by EAGAIN is kept and resumed from each message's written offset
+    Progress writeBatch();
+
+    //pops up to IOV_MAX messages or one batch budget, stopping before a WRITE_FLUSH_BEFORE one.
+    //A message larger than a chunk makes up a batch of its own. Returns false when there is nothing
+    bool fillBatch();
+
+    //parks the large message of the batch at a chunk boundary while priority messages are queued
+    bool yieldToPriority(size_t chunk);
+
+    //moves n freshly written bytes into the messages from batch_head on
+    void advance(size_t n);
+
+    void fail(WriteMessage &message, int error);
+
+    //everything the writer holds or the queue still has, oldest first
+    void failAll(int error);
+
+    //completes every waiting message the driver has sent by now (TIOCOUTQ), re-arms the timer
+    //while some are left
+    void pollCompletions();
+
+    void finishBatch();
+
+    void recycle(std::vector<char> &&bytes);
+
+    int enqueue(WriteMessage &&message, bool wait);
+
+    static constexpr auto BUFFER_POOL_CAPACITY = 16;
+    static constexpr size_t MAX_POOLED_BUFFER_SIZE = 64 * 1024;
+    //a stalled port holds at most this much outside the queue limits
+    static constexpr size_t MAX_BATCH_BYTES = 64 * 1024;
+    //how often TIOCOUTQ is sampled while completions are pending
+    static constexpr long DRAIN_POLL_INTERVAL_US = 1000;
+
+    mn::CppLinuxSerial::SerialPort *port;
+    WriteQueue queue;
+    //sent buffers flow back from the writer (producer of this queue) to java callers (consumer)
+    SpscQueue<std::vector<char>> pool;
+    //serialises java callers, keeps the pool single consumer and sequences in queue order,
+    //the writer never takes it and nobody waits for room while holding it
+    std::mutex producer_mutex;
+    //set by the writer before it sleeps, producers only signal event_fd when it is set
+    std::atomic<bool> idle;
+    std::atomic<bool> stopped;
+    int event_fd;
+    int timer_fd;
+    ErrorHandler on_error;
+    CompletionHandler on_complete;
+    PortStats *stats;
+    CaptureChannel *capture;
+    //producer side, guarded by producer_mutex
+    uint64_t drain_sequence;
+    //writer side scratch space, reused between batches
+    std::vector<WriteMessage> batch;
+    //first message of the batch that still has bytes to send
+    size_t batch_head;
+    //a message popped while a batch was being filled that has to start the next one
+    //(WRITE_FLUSH_BEFORE, or larger than a chunk)
+    WriteMessage carry;
+    bool has_carry;
+    //a partly written large message that gave way to the priority lane, resumed once it is empty
+    WriteMessage suspended;
+    bool has_suspended;
+    std::atomic<size_t> chunk_size;
+    //bytes the driver accepted since the port was opened
+    uint64_t total_written;
+    //{total_written at the end of the message, sequence} of sent messages waiting for the UART
+    std::deque<std::pair<uint64_t, uint64_t>> pending;
+    std::vector<struct iovec> iov;
+};
+
+#endif //MSERIALPORT_SERIALWRITER_H
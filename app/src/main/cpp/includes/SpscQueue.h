@@ -0,0 +1,68 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_SPSCQUEUE_H
+#define MSERIALPORT_SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+//Bounded lock-free ring for exactly one producer thread and one consumer thread.
+//Capacity is rounded up to a power of two. Nothing here blocks, waking the consumer
+//is left to the owner (eventfd), so the queue can sit under poll/epoll.
+template<typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) :
+            head(0),
+            tail(0) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    //producer only, returns false when the queue is full
+    bool push(T &&value) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) > mask) {
+            return false;
+        }
+        slots[t & mask] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    //consumer only, returns false when the queue is empty
+    bool pop(T &value) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(slots[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    //approximate when called concurrently with push/pop
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+    //producer and consumer indices live on separate cache lines
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+};
+
+#endif //MSERIALPORT_SPSCQUEUE_H
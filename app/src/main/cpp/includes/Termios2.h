@@ -0,0 +1,18 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_TERMIOS2_H
+#define MSERIALPORT_TERMIOS2_H
+
+//termios2/BOTHER lives in <asm/termbits.h>, which clashes with <termios.h>,
+//so these are implemented in their own translation unit and only take plain ints.
+
+//sets input and output speed of fd to any integer rate, returns 0 or -errno
+int SetCustomBaudRate(int fd, int baudRate);
+
+//the output speed the driver actually runs at, which may be rounded from the requested
+//rate by the UART's divisor, returns -errno on failure
+int GetActualBaudRate(int fd);
+
+#endif //MSERIALPORT_TERMIOS2_H
@@ -0,0 +1,41 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_TIMERWHEEL_H
+#define MSERIALPORT_TIMERWHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Hashed timer wheel, scheduling and expiring are O(1) per timer however many are pending.
+//Deadlines further out than one revolution stay in their slot until their round comes.
+//There is no cancel, owners ignore expired ids that already completed.
+class TimerWheel {
+public:
+    TimerWheel(uint32_t tick_ms, size_t slots, uint64_t now_ms);
+
+    //deadline_ms is absolute, on the same clock as advance()
+    void schedule(uint64_t id, uint64_t deadline_ms);
+
+    //moves the wheel up to now_ms and appends the ids whose deadline has passed
+    void advance(uint64_t now_ms, std::vector<uint64_t> &expired);
+
+    size_t size();
+
+    uint32_t tick();
+
+private:
+    struct Entry {
+        uint64_t id;
+        uint64_t deadline_tick;
+    };
+
+    std::vector<std::vector<Entry>> slots;
+    uint32_t tick_ms;
+    uint64_t current_tick;
+    size_t count;
+};
+
+#endif //MSERIALPORT_TIMERWHEEL_H
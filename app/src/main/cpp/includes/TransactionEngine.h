@@ -0,0 +1,130 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_TRANSACTIONENGINE_H
+#define MSERIALPORT_TRANSACTIONENGINE_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "TimerWheel.h"
+#include "Checksum.h"
+
+//Decides where a response ends within the bytes received so far.
+struct ResponseMatcher {
+    enum Type {
+        //exactly length bytes
+        LENGTH,
+        //up to and including the delimiter
+        DELIMITER,
+        //predicate returns the size of the complete response at the start of data, 0 while incomplete
+        PREDICATE
+    };
+
+    Type type;
+    size_t length;
+    std::vector<char> delimiter;
+    std::function<size_t(const char *data, size_t len)> predicate;
+    //a matched response failing it completes with -EBADMSG
+    ChecksumSpec checksum;
+
+    static ResponseMatcher Length(size_t length);
+
+    static ResponseMatcher Delimiter(std::vector<char> delimiter);
+
+    static ResponseMatcher Predicate(std::function<size_t(const char *data, size_t len)> predicate);
+};
+
+//Request/response correlation for one port. Requests are sent through the sender in submit
+//order, at most window of them wait for a response at a time, and responses are expected in
+//the same order. Deadlines count from submit and are kept on a timer wheel driven by
+//getTimerFd(), so the owner watches it for POLLIN next to the port.
+//submit() may be called from any thread, everything else from the read side. The sender is
+//only ever called without m_mutex held and must not block.
+class TransactionEngine {
+public:
+    //status is 0, -EBADMSG, -ETIMEDOUT, -ECANCELED or the error the sender refused the request with
+    struct Result {
+        uint64_t id;
+        int status;
+        std::vector<char> response;
+    };
+
+    //returns 0 once the request is on its way, or -errno, which completes the transaction
+    using Sender = std::function<int(std::vector<char> &&request)>;
+
+    explicit TransactionEngine(Sender sender);
+
+    virtual ~TransactionEngine();
+
+    int getTimerFd();
+
+    //how many requests may be sent before the first response arrived, 1 disables pipelining
+    void setWindow(size_t window);
+
+    //returns the transaction id, never 0
+    uint64_t submit(std::vector<char> &&request, ResponseMatcher &&matcher, uint32_t timeout_ms);
+
+    //true while a sent request waits for its response
+    bool inFlight();
+
+    //offers the unconsumed received bytes, returns how many form the oldest response (0 if none yet)
+    size_t onData(const char *data, size_t len, std::vector<Result> &done);
+
+    //call when getTimerFd() is readable
+    void onTimer(std::vector<Result> &done);
+
+    void cancelAll(std::vector<Result> &done);
+
+private:
+    struct Transaction {
+        uint64_t id;
+        std::vector<char> request;
+        ResponseMatcher matcher;
+        //received bytes already searched for the delimiter
+        size_t scanned;
+    };
+
+    //moves queued requests into the outbox while the window has room, call with m_mutex held
+    void pump();
+
+    //hands the outbox to the sender, call without m_mutex held
+    void send();
+
+    //completes a request the sender refused, the read side hears about it on the next onTimer
+    void refuse(uint64_t id, int error);
+
+    size_t match(Transaction &t, const char *data, size_t len);
+
+    void arm(bool on);
+
+    static uint64_t nowMs();
+
+    static constexpr uint32_t TICK_MS = 5;
+    static constexpr size_t WHEEL_SLOTS = 1024;
+
+    Sender sender;
+    //keeps requests reaching the sender in the order they left pending, taken before m_mutex
+    std::mutex send_mutex;
+    std::mutex m_mutex;
+    int timer_fd;
+    bool armed;
+    size_t window;
+    uint64_t next_id;
+    TimerWheel wheel;
+    std::deque<Transaction> pending;
+    std::deque<Transaction> in_flight;
+    //ids not completed yet, the wheel has no cancel
+    std::unordered_set<uint64_t> live;
+    //{id, request} of transactions moved in flight but not handed to the sender yet
+    std::vector<std::pair<uint64_t, std::vector<char>>> outbox;
+    //refused by the sender, waiting for onTimer
+    std::vector<Result> refused;
+};
+
+#endif //MSERIALPORT_TRANSACTIONENGINE_H
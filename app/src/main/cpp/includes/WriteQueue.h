@@ -0,0 +1,137 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+
+#ifndef MSERIALPORT_WRITEQUEUE_H
+#define MSERIALPORT_WRITEQUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+//per message flags, the values match SerialPortManager.WRITE_* on the java side
+enum WriteFlags : uint32_t {
+    //default, done once the driver took the bytes
+    WRITE_FIRE_AND_FORGET = 0,
+    //report completion once every byte of the message has left the UART, without holding
+    //back later messages
+    WRITE_DRAIN_AFTER = 1u << 2,
+    //discard stale received bytes right before the message goes out, so a reply read
+    //afterwards belongs to it
+    WRITE_FLUSH_BEFORE = 1u << 3,
+    //latest-value mode for state refreshes: replaces the queued, not yet picked up message with
+    //the same key, so only the newest state per key is transmitted. Needs a key
+    WRITE_LATEST = 1u << 4,
+    //goes through the priority lane, ahead of everything queued without it. Large messages in
+    //the normal lane give way to it at their next chunk boundary, see SerialWriter::setChunkSize
+    WRITE_PRIORITY = 1u << 5,
+};
+
+struct WriteMessage {
+    std::vector<char> data;
+    uint32_t flags;
+    //bytes of data already accepted by the driver
+    size_t written = 0;
+    //numbers WRITE_DRAIN_AFTER messages of a port from 1 in queue order, 0 otherwise
+    uint64_t sequence = 0;
+    //PortStats::now() at enqueue, only stamped while stats are collected
+    int64_t enqueued_ns = 0;
+    //messages with the same non-zero key carry the same state, a newer one may replace an older
+    uint64_t key = 0;
+};
+
+//what a full queue does with another message, the values match SerialPortManager.QUEUE_*
+enum QueuePolicy : int {
+    //the caller waits until the writer made room, the default
+    QUEUE_BLOCK = 0,
+    //the message is refused with -EAGAIN
+    QUEUE_FAIL_FAST = 1,
+    //the oldest queued messages are dropped to make room
+    QUEUE_DROP_OLDEST = 2,
+    //a keyed message replaces the queued one with the same key, anything else is refused
+    QUEUE_COALESCE = 3,
+};
+
+//Pending messages of one port, bounded in messages and in bytes over both lanes.
+//Producers push under the policy, a single writer pops, the priority lane strictly first. WRITE_DRAIN_AFTER messages are
+//never dropped or replaced, somebody waits to hear about them.
+//A keyed WRITE_LATEST message replaces its predecessor whether the queue is full or not.
+class WriteQueue {
+public:
+    struct PushResult {
+        //0, -EAGAIN when the policy refused the message, -EPIPE once closed
+        int error;
+        //messages dropped to make room (QUEUE_DROP_OLDEST)
+        size_t evicted;
+        //the message took the place of a queued one with the same key (WRITE_LATEST, QUEUE_COALESCE)
+        bool coalesced;
+        //queued messages after the push
+        size_t depth;
+        //refused only because a QUEUE_BLOCK queue was full and the push did not wait,
+        //the caller may waitForRoom() and try again
+        bool would_block;
+    };
+
+    WriteQueue(size_t max_messages, size_t max_bytes, QueuePolicy policy);
+
+    //takes effect from the next push, messages already queued stay
+    void setLimits(size_t max_messages, size_t max_bytes, QueuePolicy policy);
+
+    //under QUEUE_BLOCK a full queue makes it wait, unless wait is false
+    PushResult push(WriteMessage &&message, bool wait = true);
+
+    //waits while a QUEUE_BLOCK queue has no room for bytes more, returns at once under the
+    //other policies and once closed. Another producer may take the room before the next push
+    void waitForRoom(size_t bytes);
+
+    //writer side, returns false when the queue (or just the priority lane) is empty
+    bool pop(WriteMessage &message, bool priority_only = false);
+
+    size_t size();
+
+    //writer side, lock-free
+    bool hasPriority();
+
+    //refuses further pushes and wakes blocked producers
+    void close();
+
+private:
+    //call with mutex held
+    bool fits(size_t bytes);
+
+    //call with mutex held, drops the oldest message that may be dropped, normal lane first
+    bool evictOldest();
+
+    //call with mutex held, replaces the newest queued message with the same key
+    bool replaceKeyed(WriteMessage &message);
+
+    static bool replaceable(const WriteMessage &message);
+
+    enum Lane {
+        PRIORITY_LANE,
+        NORMAL_LANE,
+        LANE_COUNT
+    };
+
+    static Lane laneOf(const WriteMessage &message);
+
+    std::mutex mutex;
+    std::condition_variable not_full;
+    std::deque<WriteMessage> lanes[LANE_COUNT];
+    size_t queued_messages;
+    size_t queued_bytes;
+    //size of the priority lane, read by the writer without the lock between chunks
+    std::atomic<size_t> priority_pending;
+    size_t max_messages;
+    size_t max_bytes;
+    QueuePolicy policy;
+    //producers sleeping in push() or waitForRoom(), pop() only notifies when there are some
+    int blocked;
+    bool closed;
+};
+
+#endif //MSERIALPORT_WRITEQUEUE_H
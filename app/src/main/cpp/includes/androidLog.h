@@ -5,9 +5,17 @@
 #ifndef MSERIALPORT_ANDROIDLOG_H
 #define MSERIALPORT_ANDROIDLOG_H
 
-#include <android/log.h>
 static const char *TAG = "castle_serial_port";
+#ifdef __ANDROID__
+#include <android/log.h>
 #define LOGI(fmt, args...) __android_log_print(ANDROID_LOG_INFO,  TAG, fmt, ##args)
 #define LOGD(fmt, args...) __android_log_print(ANDROID_LOG_DEBUG, TAG, fmt, ##args)
 #define LOGE(fmt, args...) __android_log_print(ANDROID_LOG_ERROR, TAG, fmt, ##args)
+#else
+//host builds of mserialport_core (benchmarks) log to stderr, debug output is compiled out
+#include <cstdio>
+#define LOGI(fmt, args...) fprintf(stderr, "I/%s: " fmt "\n", TAG, ##args)
+#define LOGD(fmt, args...) do { if (0) fprintf(stderr, fmt, ##args); } while (0)
+#define LOGE(fmt, args...) fprintf(stderr, "E/%s: " fmt "\n", TAG, ##args)
+#endif
 #endif //MSERIALPORT_ANDROIDLOG_H
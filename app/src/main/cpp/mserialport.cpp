@@ -2,14 +2,24 @@
 #include <SerialPortManager.h>
 #include <androidLog.h>
 #include <SPReadWriteWorker.h>
+#include <JniCache.h>
+#include <algorithm>
 #include <random>
 #include <unistd.h>
 
 static SerialPortManager *mManager;
+//FLAG_WRITE/FLAG_READ share the flags argument with the WRITE_* bits and are ignored here
+static constexpr uint32_t WRITE_FLAGS_MASK =
+        WRITE_DRAIN_AFTER | WRITE_FLUSH_BEFORE | WRITE_LATEST | WRITE_PRIORITY;
 static JavaVM *g_vm;
 //用于储存读回调
 static std::unordered_map<std::string, jobject> g_callback_map;
 
+//java keys are any int, 0 must stay "no key" natively
+static uint64_t NativeKey(jint key) {
+    return static_cast<uint64_t>(static_cast<uint32_t>(key)) + 1;
+}
+
 std::vector<char> ConvertJByteArrayToVectorOfChars(JNIEnv *env, jbyteArray *bytearray) {
     jbyte *bytes;
     bytes = env->GetByteArrayElements(*bytearray, nullptr);
@@ -19,12 +29,13 @@ std::vector<char> ConvertJByteArrayToVectorOfChars(JNIEnv *env, jbyteArray *byte
     return result;
 }
 
-extern "C" JNIEXPORT void JNICALL
+extern "C" JNIEXPORT jint JNICALL
 Java_com_castle_serialport_SerialPortManager_sendMessage(
         JNIEnv *env,
         jobject thiz,
         jstring path,
-        jobjectArray commands
+        jobjectArray commands,
+        jint flags
 ) {
     const char *path_utf = env->GetStringUTFChars(path, nullptr);
     int stringCount = env->GetArrayLength(commands);
@@ -37,27 +48,360 @@ Java_com_castle_serialport_SerialPortManager_sendMessage(
         env->DeleteLocalRef(message);
     }
     auto name = std::string(path_utf);
-    mManager->sendMessage(name, msgs);
+    int result = mManager->sendMessage(name, msgs, static_cast<uint32_t>(flags) & WRITE_FLAGS_MASK);
     env->ReleaseStringUTFChars(path, path_utf);
+    return result;
 }
 
-extern "C" JNIEXPORT void JNICALL
+extern "C" JNIEXPORT jint JNICALL
 Java_com_castle_serialport_SerialPortManager_sendBytes(
         JNIEnv *env,
         jobject thiz,
         jstring path,
-        jobjectArray commands
+        jobjectArray commands,
+        jint flags
 ) {
     const char *path_utf = env->GetStringUTFChars(path, nullptr);
     int stringCount = env->GetArrayLength(commands);
     auto name = std::string(path_utf);
+    int error = 0;
     for (int i = 0; i < stringCount; ++i) {
         auto message = static_cast<jbyteArray >(env->GetObjectArrayElement(commands, i));
         auto msg = ConvertJByteArrayToVectorOfChars(env, &message);
-        mManager->sendBytesMessage(name, msg);
+        int result = mManager->sendBytesMessage(name, msg,
+                                                static_cast<uint32_t>(flags) & WRITE_FLAGS_MASK);
+        if (error == 0)
+            error = result;
         env->DeleteLocalRef(message);
     }
     env->ReleaseStringUTFChars(path, path_utf);
+    return error;
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_castle_serialport_SerialPortManager_sendKeyedBytes(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path,
+        jint key,
+        jbyteArray msg,
+        jint flags
+) {
+    const char *path_utf = env->GetStringUTFChars(path, nullptr);
+    auto name = std::string(path_utf);
+    env->ReleaseStringUTFChars(path, path_utf);
+    return mManager->sendBytesMessage(name, ConvertJByteArrayToVectorOfChars(env, &msg),
+                                      static_cast<uint32_t>(flags) & WRITE_FLAGS_MASK,
+                                      NativeKey(key));
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_castle_serialport_SerialPortManager_sendKeyedMessage(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path,
+        jint key,
+        jstring msg,
+        jint flags
+) {
+    const char *path_utf = env->GetStringUTFChars(path, nullptr);
+    const char *msg_utf = env->GetStringUTFChars(msg, nullptr);
+    auto name = std::string(path_utf);
+    std::vector<std::string> msgs = {std::string(msg_utf)};
+    env->ReleaseStringUTFChars(msg, msg_utf);
+    env->ReleaseStringUTFChars(path, path_utf);
+    return mManager->sendMessage(name, msgs, static_cast<uint32_t>(flags) & WRITE_FLAGS_MASK,
+                                 NativeKey(key));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_castle_serialport_SerialPortManager_setWriteQueueLimits(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path,
+        jint maxMessages,
+        jint maxBytes,
+        jint policy
+) {
+    if (maxMessages <= 0 || maxBytes <= 0 || policy < QUEUE_BLOCK || policy > QUEUE_COALESCE) {
+        LOGE("非法的发送队列设置: %d, %d, %d", maxMessages, maxBytes, policy);
+        return;
+    }
+    const char *path_utf = env->GetStringUTFChars(path, nullptr);
+    auto name = std::string(path_utf);
+    std::string command = SET_WRITE_QUEUE + std::to_string(maxMessages) + "," +
+                          std::to_string(maxBytes) + "," + std::to_string(policy);
+    mManager->sendMessage(name, {std::move(command)});
+    env->ReleaseStringUTFChars(path, path_utf);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_castle_serialport_SerialPortManager_flush(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path
+) {
+    const char *path_utf = env->GetStringUTFChars(path, nullptr);
+    auto name = std::string(path_utf);
+    mManager->sendMessage(name, {FLUSH});
+    env->ReleaseStringUTFChars(path, path_utf);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_castle_serialport_SerialPortManager_setOnWriteCompleteListener(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path,
+        jobject listener
+) {
+    const char *path_utf = env->GetStringUTFChars(path, nullptr);
+    auto name = std::string(path_utf);
+    if (mManager->setWriteListener(name, env, listener) != 0) {
+        LOGE("串口%s未打开", path_utf);
+    }
+    env->ReleaseStringUTFChars(path, path_utf);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_castle_serialport_SerialPortManager_getBaudRate(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path
+) {
+    const char *path_utf = env->GetStringUTFChars(path, nullptr);
+    auto name = std::string(path_utf);
+    int rate = mManager->getActualBaudRate(name);
+    env->ReleaseStringUTFChars(path, path_utf);
+    return rate;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_castle_serialport_SerialPortManager_setLowLatency(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path,
+        jboolean enabled
+) {
+    const char *path_utf = env->GetStringUTFChars(path, nullptr);
+    auto name = std::string(path_utf);
+    std::string command = SET_LOW_LATENCY + std::to_string(enabled == JNI_TRUE ? 1 : 0);
+    mManager->sendMessage(name, {std::move(command)});
+    env->ReleaseStringUTFChars(path, path_utf);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_castle_serialport_SerialPortManager_setFirstByteEstimate(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path,
+        jboolean enabled
+) {
+    const char *path_utf = env->GetStringUTFChars(path, nullptr);
+    auto name = std::string(path_utf);
+    std::string command = SET_FIRST_BYTE_ESTIMATE + std::to_string(enabled == JNI_TRUE ? 1 : 0);
+    mManager->sendMessage(name, {std::move(command)});
+    env->ReleaseStringUTFChars(path, path_utf);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_castle_serialport_SerialPortManager_receiveClockNanos(
+        JNIEnv *env,
+        jobject thiz
+) {
+    return static_cast<jlong>(RxTimeline::now());
+}
+
+extern "C" JNIEXPORT jintArray JNICALL
+Java_com_castle_serialport_SerialPortManager_getLatencySettings(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path
+) {
+    const char *path_utf = env->GetStringUTFChars(path, nullptr);
+    auto name = std::string(path_utf);
+    auto settings = mManager->getLatencySettings(name);
+    env->ReleaseStringUTFChars(path, path_utf);
+    jint values[2] = {settings.lowLatency, settings.latencyTimer_ms};
+    jintArray result = env->NewIntArray(2);
+    env->SetIntArrayRegion(result, 0, 2, values);
+    return result;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_castle_serialport_SerialPortManager_nativeGetPortStats(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path
+) {
+    const char *path_utf = env->GetStringUTFChars(path, nullptr);
+    auto name = std::string(path_utf);
+    env->ReleaseStringUTFChars(path, path_utf);
+    PortStats::Snapshot snapshot = {};
+    if (mManager->getPortStats(name, snapshot) != 0) {
+        return nullptr;
+    }
+    //counters in PortStats::Counter order, then count/sum/max/p50/p90/p99/p999 per histogram
+    constexpr size_t HISTOGRAM_FIELDS = 7;
+    jlong values[PortStats::COUNTER_COUNT + PortStats::HISTOGRAM_COUNT * HISTOGRAM_FIELDS];
+    size_t i = 0;
+    for (auto counter : snapshot.counters) {
+        values[i++] = static_cast<jlong>(counter);
+    }
+    for (auto &&h : snapshot.histograms) {
+        for (auto value : {h.count, h.sum, h.max, h.p50, h.p90, h.p99, h.p999}) {
+            values[i++] = static_cast<jlong>(value);
+        }
+    }
+    auto len = static_cast<jsize>(i);
+    jlongArray result = env->NewLongArray(len);
+    env->SetLongArrayRegion(result, 0, len, values);
+    return result;
+}
+
+//copies a java FrameChecksum, null means none. Returns false for an unknown type or a negative skip
+static bool ReadChecksumSpec(JNIEnv *env, jobject checksum, ChecksumSpec &spec) {
+    spec = ChecksumSpec();
+    if (checksum == nullptr) {
+        return true;
+    }
+    jint type = env->GetIntField(checksum, g_jni_cache.frameChecksumType);
+    jint skip = env->GetIntField(checksum, g_jni_cache.frameChecksumSkip);
+    if (!ChecksumValidType(type) || skip < 0) {
+        return false;
+    }
+    spec.type = type;
+    spec.skip = static_cast<size_t>(skip);
+    spec.big_endian = env->GetBooleanField(checksum, g_jni_cache.frameChecksumBigEndian) == JNI_TRUE;
+    return true;
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_castle_serialport_SerialPortManager_checksum(
+        JNIEnv *env,
+        jobject thiz,
+        jint type,
+        jobject buffer,
+        jint offset,
+        jint length
+) {
+    if (!ChecksumValidType(type) || offset < 0 || length < 0) {
+        return -EINVAL;
+    }
+    //no copy, the direct buffer is read where it lies
+    auto *data = static_cast<const char *>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (data == nullptr || static_cast<jlong>(offset) + length > capacity) {
+        return -EINVAL;
+    }
+    return static_cast<jlong>(Checksum(static_cast<ChecksumType>(type), data + offset,
+                                       static_cast<size_t>(length)));
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_castle_serialport_SerialPortManager_checksumBytes(
+        JNIEnv *env,
+        jobject thiz,
+        jint type,
+        jbyteArray bytes,
+        jint offset,
+        jint length
+) {
+    if (!ChecksumValidType(type) || offset < 0 || length < 0 ||
+        static_cast<jlong>(offset) + length > env->GetArrayLength(bytes)) {
+        return -EINVAL;
+    }
+    auto *data = static_cast<const char *>(env->GetPrimitiveArrayCritical(bytes, nullptr));
+    if (data == nullptr) {
+        return -ENOMEM;
+    }
+    uint32_t value = Checksum(static_cast<ChecksumType>(type), data + offset,
+                              static_cast<size_t>(length));
+    env->ReleasePrimitiveArrayCritical(bytes, const_cast<char *>(data), JNI_ABORT);
+    return static_cast<jlong>(value);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_castle_serialport_SerialPortManager_transact(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path,
+        jbyteArray request,
+        jint responseLength,
+        jbyteArray delimiter,
+        jint timeoutMs,
+        jobject listener,
+        jobject checksum
+) {
+    ChecksumSpec checksumSpec;
+    if (listener == nullptr || timeoutMs < 0 || (delimiter == nullptr && responseLength <= 0) ||
+        !ReadChecksumSpec(env, checksum, checksumSpec)) {
+        return -EINVAL;
+    }
+    const char *path_utf = env->GetStringUTFChars(path, nullptr);
+    auto name = std::string(path_utf);
+    env->ReleaseStringUTFChars(path, path_utf);
+    auto matcher = delimiter != nullptr ?
+                   ResponseMatcher::Delimiter(ConvertJByteArrayToVectorOfChars(env, &delimiter)) :
+                   ResponseMatcher::Length(static_cast<size_t>(responseLength));
+    matcher.checksum = checksumSpec;
+    return mManager->submitTransaction(name, env, ConvertJByteArrayToVectorOfChars(env, &request),
+                                       std::move(matcher), static_cast<uint32_t>(timeoutMs),
+                                       listener);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_castle_serialport_SerialPortManager_nativeStartModbusPolling(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path,
+        jintArray reads,
+        jint periodMs,
+        jint timeoutMs,
+        jobject listener
+) {
+    //four ints per read: slave, function, address, count
+    jsize len = env->GetArrayLength(reads);
+    if (len % 4 != 0 || periodMs < 0 || timeoutMs <= 0 || (len > 0 && listener == nullptr)) {
+        return -EINVAL;
+    }
+    std::vector<jint> fields(static_cast<size_t>(len));
+    env->GetIntArrayRegion(reads, 0, len, fields.data());
+    std::vector<ModbusRead> polls;
+    for (jsize i = 0; i < len; i += 4) {
+        if (fields[i] < 0 || fields[i] > 0xFF || fields[i + 1] < 0 || fields[i + 1] > 0xFF ||
+            fields[i + 2] < 0 || fields[i + 2] > 0xFFFF || fields[i + 3] < 0 || fields[i + 3] > 0xFFFF) {
+            return -EINVAL;
+        }
+        ModbusRead read = {static_cast<uint8_t>(fields[i]), static_cast<uint8_t>(fields[i + 1]),
+                           static_cast<uint16_t>(fields[i + 2]), static_cast<uint16_t>(fields[i + 3])};
+        if (!ModbusValidRead(read)) {
+            LOGE("非法的Modbus读请求: 从站%d 功能码%d 数量%d", fields[i], fields[i + 1], fields[i + 3]);
+            return -EINVAL;
+        }
+        polls.push_back(read);
+    }
+    //an empty list stops polling and drops the listener
+    jobject target = polls.empty() ? nullptr : listener;
+    const char *path_utf = env->GetStringUTFChars(path, nullptr);
+    auto name = std::string(path_utf);
+    env->ReleaseStringUTFChars(path, path_utf);
+    return mManager->startModbusPolling(name, env, std::move(polls),
+                                        static_cast<uint32_t>(periodMs),
+                                        static_cast<uint32_t>(timeoutMs), target);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_castle_serialport_SerialPortManager_setTransactionWindow(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path,
+        jint window
+) {
+    const char *path_utf = env->GetStringUTFChars(path, nullptr);
+    auto name = std::string(path_utf);
+    std::string command = SET_TRANSACTION_WINDOW + std::to_string(window);
+    mManager->sendMessage(name, {std::move(command)});
+    env->ReleaseStringUTFChars(path, path_utf);
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -83,6 +427,10 @@ jint JNI_OnLoad(JavaVM *jvm, void *reserved) {
         std::__throw_runtime_error("Get java env failed!");
         return -1;
     }
+    if (!InitJniCache(env)) {
+        LOGE("缓存java回调方法失败");
+        return -1;
+    }
     return JNI_VERSION_1_4;
 }
 
@@ -106,31 +454,257 @@ Java_com_castle_serialport_SerialPortManager_setReadTimeInterval(
     env->ReleaseStringUTFChars(path, path_utf);
 }
 
+extern "C" JNIEXPORT jint JNICALL
+Java_com_castle_serialport_SerialPortManager_setReadBufferSize(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path,
+        jint size
+) {
+    //SerialPort::SetReadBufferSize throws beyond that, on this thread nothing would catch it
+    if (size < 1 || size > 64 * 1024) {
+        LOGE("非法的读缓冲区大小: %d", size);
+        return -EINVAL;
+    }
+    const char *path_utf = env->GetStringUTFChars(path, nullptr);
+    auto name = std::string(path_utf);
+    std::string command = SET_READ_BUFFER_SIZE + std::to_string(size);
+    int result = mManager->sendMessage(name, {std::move(command)});
+    env->ReleaseStringUTFChars(path, path_utf);
+    return result;
+}
+
 extern "C" JNIEXPORT void JNICALL
-Java_com_castle_serialport_SerialPortManager_openSerialPort(
+Java_com_castle_serialport_SerialPortManager_setWriteChunkSize(
         JNIEnv *env,
         jobject thiz,
         jstring path,
-        jint baudRate,
-        jobject callback
+        jint size
 ) {
+    if (size < 0) {
+        LOGE("非法的分块大小: %d", size);
+        return;
+    }
+    const char *path_utf = env->GetStringUTFChars(path, nullptr);
+    auto name = std::string(path_utf);
+    std::string command = SET_WRITE_CHUNK + std::to_string(size);
+    mManager->sendMessage(name, {std::move(command)});
+    env->ReleaseStringUTFChars(path, path_utf);
+}
+
+static SerialPortManager::WorkerFactory WorkerFactory(const std::string &path, jint baudRate,
+                                                     jobject *callback,
+                                                     FrameDispatcher::Mode mode,
+                                                     const FrameDecoderSpec &decoder = FrameDecoderSpec()) {
+    //the reactor is created here, on the calling thread, not concurrently by the factories
+    SerialPortReactor *reactor = mManager->getReactor(g_vm);
+    std::string name = path;
+    return [name, baudRate, callback, mode, reactor, decoder]() mutable -> std::unique_ptr<IWorker> {
+        return std::make_unique<SPReadWriteWorker>(name, baudRate, g_vm, callback, reactor, mode,
+                                                   decoder);
+    };
+}
+
+//copies a java FrameDecoder, null means idle gap framing
+static FrameDecoderSpec ReadFrameDecoderSpec(JNIEnv *env, jobject decoder) {
+    FrameDecoderSpec spec;
+    if (decoder == nullptr) {
+        return spec;
+    }
+    spec.type = env->GetIntField(decoder, g_jni_cache.frameDecoderType);
+    auto params = static_cast<jintArray>(env->GetObjectField(decoder, g_jni_cache.frameDecoderParams));
+    if (params != nullptr) {
+        spec.params.resize(static_cast<size_t>(env->GetArrayLength(params)));
+        env->GetIntArrayRegion(params, 0, static_cast<jsize>(spec.params.size()),
+                               reinterpret_cast<jint *>(spec.params.data()));
+        env->DeleteLocalRef(params);
+    }
+    auto delimiter = static_cast<jbyteArray>(env->GetObjectField(decoder,
+                                                                 g_jni_cache.frameDecoderDelimiter));
+    if (delimiter != nullptr) {
+        spec.delimiter = ConvertJByteArrayToVectorOfChars(env, &delimiter);
+        env->DeleteLocalRef(delimiter);
+    }
+    jobject checksum = env->GetObjectField(decoder, g_jni_cache.frameDecoderChecksum);
+    if (!ReadChecksumSpec(env, checksum, spec.checksum)) {
+        //FrameDecoder::create() refuses it
+        spec.checksum.type = CHECKSUM_TYPE_COUNT;
+    }
+    if (checksum != nullptr)
+        env->DeleteLocalRef(checksum);
+    return spec;
+}
+
+static void OpenSerialPort(JNIEnv *env, jstring path, jint baudRate, jobject callback,
+                           FrameDispatcher::Mode mode, jobject decoder) {
+    FrameDecoderSpec spec = ReadFrameDecoderSpec(env, decoder);
+    if (spec.type != FrameDecoderSpec::NONE && FrameDecoder::create(spec, SPReadWriteWorker::MAX_FRAME_SIZE) == nullptr) {
+        LOGE("非法的帧解码器参数, 类型%d", spec.type);
+        return;
+    }
     const char *path_utf = env->GetStringUTFChars(path, nullptr);
     if (mManager->hasSerialPort(path_utf)) {
         LOGE("请不要重复添加串口,路径%s", path_utf);
+        env->ReleaseStringUTFChars(path, path_utf);
         return;
     }
     auto name = std::string(path_utf);
     if (callback != nullptr) {
         g_callback_map[path_utf] = env->NewGlobalRef(callback);
         mManager->addSerialPort(path_utf,
-                                std::make_unique<SPReadWriteWorker>(name, baudRate, g_vm,
-                                                                    &g_callback_map[name]));
+                                WorkerFactory(name, baudRate, &g_callback_map[name], mode, spec)());
         mManager->sendMessage(name, {START_READ});
     } else {
         mManager->addSerialPort(path_utf,
-                                std::make_unique<SPReadWriteWorker>(name, baudRate,
-                                                                    nullptr,
-                                                                    nullptr));
+                                WorkerFactory(name, baudRate, nullptr, FrameDispatcher::BYTE_ARRAY)());
     }
     env->ReleaseStringUTFChars(path, path_utf);
 }
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_castle_serialport_SerialPortManager_openSerialPorts(
+        JNIEnv *env,
+        jobject thiz,
+        jobjectArray paths,
+        jintArray baudRates,
+        jobjectArray callbacks
+) {
+    int count = env->GetArrayLength(paths);
+    if (env->GetArrayLength(baudRates) < count ||
+        (callbacks != nullptr && env->GetArrayLength(callbacks) < count)) {
+        LOGE("串口参数数组长度不一致");
+        return 0;
+    }
+    jint *rates = env->GetIntArrayElements(baudRates, nullptr);
+    std::vector<std::pair<std::string, SerialPortManager::WorkerFactory>> ports;
+    std::vector<std::string> readers;
+    for (int i = 0; i < count; ++i) {
+        auto path = static_cast<jstring>(env->GetObjectArrayElement(paths, i));
+        const char *path_utf = env->GetStringUTFChars(path, nullptr);
+        auto name = std::string(path_utf);
+        env->ReleaseStringUTFChars(path, path_utf);
+        env->DeleteLocalRef(path);
+        bool duplicate = std::any_of(ports.begin(), ports.end(),
+                                     [&name](const std::pair<std::string, SerialPortManager::WorkerFactory> &p) {
+                                         return p.first == name;
+                                     });
+        if (duplicate || mManager->hasSerialPort(name)) {
+            LOGE("请不要重复添加串口,路径%s", name.c_str());
+            continue;
+        }
+        jobject callback = callbacks != nullptr ? env->GetObjectArrayElement(callbacks, i) : nullptr;
+        jobject *slot = nullptr;
+        if (callback != nullptr) {
+            //all slots exist before any worker starts, the map is not touched concurrently
+            g_callback_map[name] = env->NewGlobalRef(callback);
+            slot = &g_callback_map[name];
+            readers.push_back(name);
+            env->DeleteLocalRef(callback);
+        }
+        ports.emplace_back(name, WorkerFactory(name, rates[i], slot, FrameDispatcher::BYTE_ARRAY));
+    }
+    env->ReleaseIntArrayElements(baudRates, rates, JNI_ABORT);
+    int opened = mManager->addSerialPorts(std::move(ports));
+    for (auto &&name : readers) {
+        if (mManager->hasSerialPort(name)) {
+            mManager->sendMessage(name, {START_READ});
+        } else {
+            env->DeleteGlobalRef(g_callback_map[name]);
+            g_callback_map.erase(name);
+        }
+    }
+    return opened;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_castle_serialport_SerialPortManager_openSerialPort(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path,
+        jint baudRate,
+        jobject callback,
+        jobject decoder
+) {
+    OpenSerialPort(env, path, baudRate, callback, FrameDispatcher::BYTE_ARRAY, decoder);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_castle_serialport_SerialPortManager_openSerialPortDirect(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path,
+        jint baudRate,
+        jobject callback,
+        jobject decoder
+) {
+    OpenSerialPort(env, path, baudRate, callback, FrameDispatcher::DIRECT_BUFFER, decoder);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_castle_serialport_SerialPortManager_openSerialPortBatched(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path,
+        jint baudRate,
+        jobject callback,
+        jobject decoder
+) {
+    OpenSerialPort(env, path, baudRate, callback, FrameDispatcher::BATCH, decoder);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_castle_serialport_SerialPortManager_setBatchDelivery(
+        JNIEnv *env,
+        jobject thiz,
+        jstring path,
+        jint maxFrames,
+        jint maxDelayUs
+) {
+    const char *path_utf = env->GetStringUTFChars(path, nullptr);
+    auto name = std::string(path_utf);
+    std::string command = SET_BATCH_DELIVERY + std::to_string(maxFrames) + "," +
+                          std::to_string(maxDelayUs);
+    mManager->sendMessage(name, {std::move(command)});
+    env->ReleaseStringUTFChars(path, path_utf);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_castle_serialport_SerialPortManager_setReactorMode(
+        JNIEnv *env,
+        jobject thiz,
+        jboolean enabled
+) {
+    mManager->setReactorMode(enabled == JNI_TRUE);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_castle_serialport_SerialPortManager_startCapture(
+        JNIEnv *env,
+        jobject thiz,
+        jstring dir,
+        jint segmentBytes,
+        jint maxSegments,
+        jstring path
+) {
+    if (dir == nullptr || segmentBytes <= 0) {
+        return -EINVAL;
+    }
+    const char *dir_utf = env->GetStringUTFChars(dir, nullptr);
+    std::string directory(dir_utf);
+    env->ReleaseStringUTFChars(dir, dir_utf);
+    std::string port;
+    if (path != nullptr) {
+        const char *path_utf = env->GetStringUTFChars(path, nullptr);
+        port = path_utf;
+        env->ReleaseStringUTFChars(path, path_utf);
+    }
+    return mManager->startCapture(directory, static_cast<size_t>(segmentBytes), maxSegments, port);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_castle_serialport_SerialPortManager_stopCapture(
+        JNIEnv *env,
+        jobject thiz
+) {
+    mManager->stopCapture();
+}
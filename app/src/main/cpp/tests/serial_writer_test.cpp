@@ -0,0 +1,188 @@
+//
+// Created by Administrator on 2026/10/16.
+//
+// SerialWriter over an openpty() pair, the slave end opened through SerialPort and the writer
+// pumped on the calling thread. Host only: run through ctest, exits non-zero on the first failure.
+
+#include <pty.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../includes/SerialPort.hpp"
+#include "../includes/SerialWriter.h"
+
+using namespace mn::CppLinuxSerial;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            exit(1); \
+        } \
+    } while (0)
+
+struct Loopback {
+    int master = -1;
+    int slave = -1;
+    std::unique_ptr<SerialPort> port;
+
+    Loopback() {
+        char name[128];
+        CHECK(openpty(&master, &slave, name, nullptr, nullptr) == 0);
+        port.reset(new SerialPort(name, 115200));
+        port->SetNonBlocking(true);
+        port->Open();
+        struct termios tio = {};
+        tcgetattr(master, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(master, TCSANOW, &tio);
+    }
+
+    ~Loopback() {
+        port->Close();
+        close(slave);
+        close(master);
+    }
+};
+
+struct Completion {
+    uint64_t sequence;
+    int error;
+};
+
+//reads what reached the device and services the drain timer until want completions arrived
+static void waitFor(Loopback &loop, SerialWriter &writer, std::vector<Completion> &done,
+                    size_t want) {
+    char buffer[256];
+    for (int round = 0; round < 1000 && done.size() < want; ++round) {
+        struct pollfd fds[2] = {{loop.master,         POLLIN, 0},
+                                {writer.getTimerFd(), POLLIN, 0}};
+        poll(fds, 2, 5);
+        if (fds[0].revents & POLLIN) {
+            CHECK(read(loop.master, buffer, sizeof(buffer)) > 0);
+        }
+        if (fds[1].revents & POLLIN) {
+            writer.onTimer();
+        }
+    }
+}
+
+//flush() on an idle port queues an empty WRITE_DRAIN_AFTER message on its own
+static void testStandaloneFlush() {
+    Loopback loop;
+    SerialWriter writer(loop.port.get(), 16, 4096);
+    std::vector<Completion> done;
+    writer.setCompletionHandler([&](uint64_t sequence, int error) {
+        done.push_back({sequence, error});
+    });
+    CHECK(writer.enqueue({std::vector<char>(), WRITE_DRAIN_AFTER}) == 0);
+    CHECK(!writer.onEvent());
+    CHECK(done.size() == 1);
+    CHECK(done[0].sequence == 1);
+    CHECK(done[0].error == 0);
+}
+
+//the flush completes once the bytes queued ahead of it left the driver
+static void testFlushAfterData() {
+    Loopback loop;
+    SerialWriter writer(loop.port.get(), 16, 4096);
+    std::vector<Completion> done;
+    writer.setCompletionHandler([&](uint64_t sequence, int error) {
+        done.push_back({sequence, error});
+    });
+    CHECK(writer.enqueue({std::vector<char>(64, 'a'), WRITE_FIRE_AND_FORGET}) == 0);
+    CHECK(writer.enqueue({std::vector<char>(), WRITE_DRAIN_AFTER}) == 0);
+    CHECK(!writer.onEvent());
+    waitFor(loop, writer, done, 1);
+    CHECK(done.size() == 1);
+    CHECK(done[0].sequence == 1);
+    CHECK(done[0].error == 0);
+    //and a second one on its own after that
+    CHECK(writer.enqueue({std::vector<char>(), WRITE_DRAIN_AFTER}) == 0);
+    CHECK(!writer.onEvent());
+    waitFor(loop, writer, done, 2);
+    CHECK(done.size() == 2);
+    CHECK(done[1].sequence == 2);
+    CHECK(done[1].error == 0);
+}
+
+//a producer waiting for room under QUEUE_BLOCK keeps neither other producers nor
+//tryEnqueue callers waiting
+static void testBlockedProducer() {
+    Loopback loop;
+    SerialWriter writer(loop.port.get(), 1, 4096);
+    CHECK(writer.enqueue({std::vector<char>(8, 'a'), WRITE_FIRE_AND_FORGET}) == 0);
+    std::atomic<bool> queued(false);
+    std::thread producer([&] {
+        CHECK(writer.enqueue({std::vector<char>(8, 'b'), WRITE_FIRE_AND_FORGET}) == 0);
+        queued.store(true);
+    });
+    usleep(50 * 1000);
+    CHECK(!queued.load());
+    //both take the producer lock
+    CHECK(writer.tryEnqueue({std::vector<char>(8, 'c'), WRITE_FIRE_AND_FORGET}) == -EAGAIN);
+    writer.acquireBuffer();
+    CHECK(!writer.onEvent());
+    producer.join();
+    CHECK(queued.load());
+}
+
+//stop() on the writer side fails what never went out instead of dropping it
+static void testStopFailsQueued() {
+    Loopback loop;
+    SerialWriter writer(loop.port.get(), 16, 4096);
+    std::vector<Completion> done;
+    std::vector<int> errors;
+    writer.setCompletionHandler([&](uint64_t sequence, int error) {
+        done.push_back({sequence, error});
+    });
+    writer.setErrorHandler([&](const WriteMessage &, int error) {
+        errors.push_back(error);
+    });
+    CHECK(writer.enqueue({std::vector<char>(64, 'a'), WRITE_FIRE_AND_FORGET}) == 0);
+    CHECK(writer.enqueue({std::vector<char>(), WRITE_DRAIN_AFTER}) == 0);
+    writer.stop();
+    CHECK(errors.size() == 2);
+    CHECK(errors[0] == EPIPE);
+    CHECK(errors[1] == EPIPE);
+    CHECK(done.size() == 1);
+    CHECK(done[0].sequence == 1);
+    CHECK(done[0].error == EPIPE);
+    CHECK(writer.enqueue({std::vector<char>(8, 'b'), WRITE_FIRE_AND_FORGET}) == -EPIPE);
+    CHECK(!writer.onEvent());
+    CHECK(errors.size() == 2);
+}
+
+//close() from another thread leaves the failing to the writer's next event
+static void testCloseFailsOnWriterSide() {
+    Loopback loop;
+    SerialWriter writer(loop.port.get(), 16, 4096);
+    std::vector<Completion> done;
+    writer.setCompletionHandler([&](uint64_t sequence, int error) {
+        done.push_back({sequence, error});
+    });
+    CHECK(writer.enqueue({std::vector<char>(64, 'a'), WRITE_DRAIN_AFTER}) == 0);
+    std::thread([&] { writer.close(); }).join();
+    CHECK(done.empty());
+    struct pollfd fd = {writer.getEventFd(), POLLIN, 0};
+    CHECK(poll(&fd, 1, 0) == 1);
+    CHECK(!writer.onEvent());
+    CHECK(done.size() == 1);
+    CHECK(done[0].error == EPIPE);
+}
+
+int main() {
+    testStandaloneFlush();
+    testFlushAfterData();
+    testBlockedProducer();
+    testStopFailsQueued();
+    testCloseFailsOnWriterSide();
+    printf("serial_writer_test passed\n");
+    return 0;
+}
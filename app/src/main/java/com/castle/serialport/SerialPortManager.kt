@@ -1,6 +1,7 @@
 package com.castle.serialport
 
 import android.util.Log
+import java.nio.ByteBuffer
 
 
 object SerialPortManager {
@@ -8,6 +9,46 @@ object SerialPortManager {
     const val FLAG_WRITE = 1;
     //读flag
     const val FLAG_READ = 2;
+    //写入驱动即返回, 默认行为
+    const val WRITE_FIRE_AND_FORGET = 0;
+    //本条消息真正发送完毕后通过[OnWriteCompleteListener]通知, 不会阻塞后续消息
+    const val WRITE_DRAIN_AFTER = 4;
+    //发送本条消息前丢弃尚未读取的接收数据, 保证之后读到的是本条消息的应答
+    const val WRITE_FLUSH_BEFORE = 8;
+    //只发送最新状态: 队列中同一key尚未发送的旧消息被本条替换, 适合屏幕页面等反复刷新的状态, 需配合[sendKeyedMessage]/[sendKeyedBytes]
+    const val WRITE_LATEST = 16;
+    //走优先通道, 先于所有普通消息发送, 例如急停和心跳; 正在发送的大消息在下一个分块边界让路, 见[setWriteChunkSize]
+    const val WRITE_PRIORITY = 32;
+    //发送队列满时: 阻塞调用线程直到有空间, 默认行为
+    const val QUEUE_BLOCK = 0;
+    //发送队列满时: 直接返回-11(EAGAIN)
+    const val QUEUE_FAIL_FAST = 1;
+    //发送队列满时: 丢弃最早排队的消息
+    const val QUEUE_DROP_OLDEST = 2;
+    //发送队列满时: 用[sendKeyedBytes]发送的消息替换队列中同一key的旧消息, 其余消息返回-11(EAGAIN)
+    const val QUEUE_COALESCE = 3;
+    //Modbus功能码: 读线圈
+    const val MODBUS_READ_COILS = 1;
+    //Modbus功能码: 读离散输入
+    const val MODBUS_READ_DISCRETE_INPUTS = 2;
+    //Modbus功能码: 读保持寄存器
+    const val MODBUS_READ_HOLDING_REGISTERS = 3;
+    //Modbus功能码: 读输入寄存器
+    const val MODBUS_READ_INPUT_REGISTERS = 4;
+    //CRC-8, 多项式0x07, 初值0 (SMBus)
+    const val CHECKSUM_CRC8 = 0;
+    //CRC-8/MAXIM, 多项式0x31反射, 初值0 (1-Wire)
+    const val CHECKSUM_CRC8_MAXIM = 1;
+    //CRC-16/MODBUS, 多项式0x8005反射, 初值0xFFFF, 低字节在前发送
+    const val CHECKSUM_CRC16_MODBUS = 2;
+    //CRC-16/CCITT-FALSE, 多项式0x1021, 初值0xFFFF
+    const val CHECKSUM_CRC16_CCITT = 3;
+    //CRC-16/XMODEM, 多项式0x1021, 初值0
+    const val CHECKSUM_CRC16_XMODEM = 4;
+    //CRC-32, 与zlib和java.util.zip.CRC32相同
+    const val CHECKSUM_CRC32 = 5;
+    //CRC-32C (Castagnoli)
+    const val CHECKSUM_CRC32C = 6;
 
     init {
         Log.d("SerialPortManager", "开始加载库")
@@ -26,35 +67,515 @@ object SerialPortManager {
      * 发送消息给指定串口, 底层已经为串口读写专门开启线程,上层可以直接调用,无需切换线程
      * @param path 串口路径,通常为/dev/tty*开头
      * @param msg 要发送给串口的消息, 直接传入hexString即可, 底层会将其转换成为16进制byte数组
-     * @param flags 标记, 1->只写,2->只读,3->读写
-     * @return 如果失败,底层会直接抛出异常
+     * @param flags 标记, 1->只写,2->只读,3->读写, 可以再组合[WRITE_DRAIN_AFTER]和[WRITE_FLUSH_BEFORE]
+     * @return 0为成功, 串口未打开为-19(ENODEV), 发送队列拒绝为-11(EAGAIN), 见[setWriteQueueLimits],
+     * 含有非法或奇数长度的16进制字符串为-22(EINVAL), 其余合法的消息照常发送
      */
-    external fun sendMessage(path: String, msg: Array<String>, flags: Int = FLAG_WRITE)
+    external fun sendMessage(path: String, msg: Array<String>, flags: Int = FLAG_WRITE): Int
 
     /**
      * 发送消息给指定串口, 底层已经为串口读写专门开启线程,上层可以直接调用,无需切换线程
      * @param path 串口路径,通常为/dev/tty*开头
      * @param msg 要发送给串口的消息, 传入byte数组即可
-     * @param flags 标记, 1->只写,2->只读,3->读写
-     * @return 如果失败,底层会直接抛出异常
+     * @param flags 标记, 1->只写,2->只读,3->读写, 可以再组合[WRITE_DRAIN_AFTER]和[WRITE_FLUSH_BEFORE]
+     * @return 0为成功, 否则为第一条失败消息的-errno, 同[sendMessage]
      */
-    external fun sendBytes(path: String, msg: Array<ByteArray>, flags: Int = FLAG_WRITE)
+    external fun sendBytes(path: String, msg: Array<ByteArray>, flags: Int = FLAG_WRITE): Int
 
     /**
-     * @param timeInterval 轮循读串口的时间,单位为纳秒 参考时间(键盘-500, 短码扫码头-5000, 长码扫玛头-50000)
+     * 发送一条带key的消息, 同一key的消息表示同一份状态(例如屏幕的同一页)
+     * 带[WRITE_LATEST]时总是替换队列中同一key尚未发送的旧消息, 并保留旧消息的排队位置, 串口比刷新慢时只发送最新状态;
+     * 不带时只在队列策略为[QUEUE_COALESCE]且队列已满时替换. 底层已经开始发送的消息不会被替换
+     * 带[WRITE_DRAIN_AFTER]的消息不会被替换
+     * @param path 串口路径,通常为/dev/tty*开头
+     * @param key 任意整数
+     * @param msg 要发送的数据
+     * @param flags 同[sendBytes]
+     * @return 同[sendMessage]
+     */
+    external fun sendKeyedBytes(path: String, key: Int, msg: ByteArray, flags: Int = FLAG_WRITE): Int
+
+    /**
+     * 同[sendKeyedBytes], 消息为hexString
+     * @param path 串口路径,通常为/dev/tty*开头
+     * @param key 任意整数, 例如屏幕变量的地址
+     * @param msg 要发送的hexString
+     * @param flags 同[sendMessage], 刷新状态时组合[WRITE_LATEST]
+     * @return 同[sendMessage]
+     */
+    external fun sendKeyedMessage(path: String, key: Int, msg: String, flags: Int = FLAG_WRITE): Int
+
+    /**
+     * 设置发送队列的上限及队列满时的处理策略, 防止串口卡住时消息无限堆积
+     * 默认最多256条消息, 1MB, 策略为[QUEUE_BLOCK]; 被拒绝或丢弃的消息计入[PortStats.queueRejections]
+     * 带[WRITE_DRAIN_AFTER]的消息不会被丢弃
+     * @param path 串口路径,通常为/dev/tty*开头
+     * @param maxMessages 最多排队的消息数
+     * @param maxBytes 最多排队的字节数, 单条超过该值的消息只能在队列为空时进入
+     * @param policy [QUEUE_BLOCK], [QUEUE_FAIL_FAST], [QUEUE_DROP_OLDEST]或[QUEUE_COALESCE]
+     */
+    external fun setWriteQueueLimits(path: String, maxMessages: Int, maxBytes: Int, policy: Int)
+
+    /**
+     * 设置发送分块大小: 超过该大小的消息按块发送, 每块之间优先发送带[WRITE_PRIORITY]的消息,
+     * 优先消息最多等待一块的发送时间(加上驱动缓冲区中已有的数据); 小消息最多合并到一块大小后一起发送
+     * 注意分块之间可能插入优先消息, 协议需要允许在分块边界插入其他帧
+     * @param path 串口路径,通常为/dev/tty*开头
+     * @param size 字节数, 0为不分块(默认)
+     */
+    external fun setWriteChunkSize(path: String, size: Int)
+
+    /**
+     * 插入一个空的[WRITE_DRAIN_AFTER]消息: 此前排队的所有数据真正发送完毕后通过[OnWriteCompleteListener]通知
+     * 平时排队的消息会合并成一次系统调用写出, 不会等待发送完毕, 需要确认发送完成时调用本方法
+     * 本方法不会阻塞调用线程, 也不会阻塞后续消息的发送
+     * @param path 串口路径,通常为/dev/tty*开头
+     */
+    external fun flush(path: String)
+
+    /**
+     * 设置发送完成监听, 带[WRITE_DRAIN_AFTER]的消息及[flush]发送完毕后回调
+     * @param path 串口路径,通常为/dev/tty*开头, 需要先打开串口
+     * @param listener 为空时移除监听
+     */
+    external fun setOnWriteCompleteListener(path: String, listener: OnWriteCompleteListener?)
+
+    /**
+     * 发送一条请求并等待应答, 应答按长度或结束符匹配, 超时或成功都会回调一次, 不会阻塞调用线程
+     * 等待应答期间收到的数据优先交给事务, 其余数据照常回调读监听; 只写串口会在第一次调用时开始读取
+     * @param path 串口路径,通常为/dev/tty*开头
+     * @param request 请求数据
+     * @param responseLength 应答的固定长度, delimiter不为空时忽略
+     * @param delimiter 应答的结束符, 应答包含结束符
+     * @param timeoutMs 从调用开始计算的超时时间,单位为毫秒, 精度5毫秒
+     * @param listener 结果回调, 在底层读线程执行
+     * @param checksum 应答末尾的校验码, 校验失败时status为-74(EBADMSG)
+     * @return 事务编号, 小于0时为失败的-errno
+     */
+    external fun transact(
+        path: String,
+        request: ByteArray,
+        responseLength: Int,
+        delimiter: ByteArray?,
+        timeoutMs: Int,
+        listener: OnTransactionListener,
+        checksum: FrameChecksum? = null
+    ): Long
+
+    /**
+     * 在底层计算校验码, 直接读取DirectByteBuffer的内存, 不拷贝, 可以在[OnDirectReadListener]回调中直接使用
+     * CRC32/CRC32C在支持的CPU上使用硬件指令, 其余算法使用8路查表
+     * @param type 校验算法, 见CHECKSUM_*
+     * @param buffer 必须是DirectByteBuffer, 不依赖position和limit
+     * @param offset 数据在buffer中的起始位置
+     * @param length 数据长度
+     * @return 无符号校验值, 小于0时为失败的-errno, 参数非法时为-22(EINVAL)
+     */
+    external fun checksum(type: Int, buffer: ByteBuffer, offset: Int, length: Int): Long
+
+    /**
+     * 同[checksum], 用于ByteArray
+     */
+    external fun checksumBytes(type: Int, bytes: ByteArray, offset: Int = 0, length: Int = bytes.size): Long
+
+    /**
+     * 作为Modbus RTU主站周期轮询, 可以包含多个从站, 每个周期依次发送reads中的请求, 结束后一次性回调全部结果
+     * 请求之间至少间隔3.5个字符时间(波特率高于19200时为1750微秒), 应答按功能码和字节数切分并校验CRC
+     * 再次调用会在当前周期结束后替换轮询列表; 轮询期间不要在同一串口上使用[transact]
+     * @param path 串口路径,通常为/dev/tty*开头
+     * @param reads 读请求列表, 为空时停止轮询
+     * @param periodMs 轮询周期,单位为毫秒, 从上一周期开始时计算, 一个周期耗时更长时下一周期紧接着开始
+     * @param timeoutMs 每个请求等待应答的超时时间,单位为毫秒, 精度5毫秒
+     * @param listener 结果回调, 在底层读线程执行
+     * @return 0为成功, 小于0时为失败的-errno, 参数非法时为-22(EINVAL)
+     */
+    fun startModbusPolling(path: String, reads: List<ModbusRead>, periodMs: Int, timeoutMs: Int, listener: OnModbusPollListener): Int {
+        val fields = IntArray(reads.size * 4)
+        reads.forEachIndexed { i, read ->
+            fields[i * 4] = read.slave
+            fields[i * 4 + 1] = read.function
+            fields[i * 4 + 2] = read.address
+            fields[i * 4 + 3] = read.count
+        }
+        return nativeStartModbusPolling(path, fields, periodMs, timeoutMs, listener)
+    }
+
+    /**
+     * 停止Modbus轮询, 正在等待的请求仍会完成
+     * @param path 串口路径,通常为/dev/tty*开头
+     */
+    fun stopModbusPolling(path: String): Int = nativeStartModbusPolling(path, IntArray(0), 0, 1, null)
+
+    private external fun nativeStartModbusPolling(path: String, reads: IntArray, periodMs: Int, timeoutMs: Int, listener: OnModbusPollListener?): Int
+
+    /**
+     * 设置最多同时等待应答的请求数, 默认1即收到应答后才发送下一条请求, 支持流水线的设备可以调大
+     * 应答必须按请求顺序返回
+     * @param path 串口路径,通常为/dev/tty*开头
+     * @param window 请求数, 至少为1
+     */
+    external fun setTransactionWindow(path: String, window: Int)
+
+    /**
+     * 设置断帧间隔, 串口空闲超过该时间即认为一帧结束并回调, 为0时每次读到数据立即回调
+     * @param timeInterval 断帧空闲时间,单位为微秒 参考时间(键盘-500, 短码扫码头-5000, 长码扫玛头-50000)
      * @param path 串口路径,通常为/dev/tty*开头
      */
     external fun setReadTimeInterval(path: String, timeInterval: Int)
 
+    /**
+     * 设置单次read系统调用最多读取的字节数, 高波特率下调大可以减少系统调用次数
+     * @param path 串口路径,通常为/dev/tty*开头
+     * @param size 字节数, 1~65536, 默认4096
+     * @return 0为成功, 串口未打开为-19(ENODEV), size超出范围为-22(EINVAL)
+     */
+    external fun setReadBufferSize(path: String, size: Int): Int
+
+    /**
+     * 开启或关闭低延迟模式: 设置驱动的ASYNC_LOW_LATENCY, FTDI转换器同时把latency_timer设为1毫秒(关闭时恢复16毫秒)
+     * USB转串口默认最多缓存16毫秒才上报数据, 一问一答的协议建议开启, 驱动不支持时忽略
+     * @param path 串口路径,通常为/dev/tty*开头
+     * @param enabled 是否开启
+     */
+    external fun setLowLatency(path: String, enabled: Boolean)
+
+    /**
+     * 开启或关闭首字节到达时间估算, 开启后每次read多一次FIONREAD查询,
+     * 按驱动中尚未读取的字节数和实际波特率推算每帧第一个字节到达串口的时间, 见[OnTimedReadListener]
+     * @param path 串口路径,通常为/dev/tty*开头
+     * @param enabled 是否开启, 默认关闭
+     */
+    external fun setFirstByteEstimate(path: String, enabled: Boolean)
+
+    /**
+     * 接收时间戳所用的时钟(CLOCK_MONOTONIC_RAW)的当前值, 单位为纳秒, 用于计算延迟;
+     * 与System.nanoTime()不是同一个时钟, 不要混用
+     */
+    external fun receiveClockNanos(): Long
+
+    /**
+     * 获取串口当前实际生效的延迟设置
+     * @param path 串口路径,通常为/dev/tty*开头
+     * @return [0]为low_latency, 1开启 0关闭 小于0为驱动不支持的-errno; [1]为FTDI的latency_timer毫秒数, 非FTDI设备为-1
+     */
+    external fun getLatencySettings(path: String): IntArray
+
+    /**
+     * 获取串口运行以来的统计数据, 只是读取底层计数器, 开销很小, 可以定期调用上报
+     * @param path 串口路径,通常为/dev/tty*开头
+     * @return 串口未打开或不支持统计(旧的只读/只写串口)时为空
+     */
+    fun getPortStats(path: String): PortStats? {
+        val values = nativeGetPortStats(path) ?: return null
+        fun histogram(index: Int): LatencyStats {
+            val base = 12 + index * 7
+            return LatencyStats(
+                values[base], values[base + 1], values[base + 2],
+                values[base + 3], values[base + 4], values[base + 5], values[base + 6]
+            )
+        }
+        return PortStats(
+            values[0], values[1], values[2], values[3], values[4], values[5], values[6],
+            values[7], values[8], values[9], values[10], values[11],
+            histogram(0), histogram(1), histogram(2)
+        )
+    }
+
+    private external fun nativeGetPortStats(path: String): LongArray?
+
+    /**
+     * 获取串口实际运行的波特率, 非标准波特率由硬件分频得到, 可能与设置值略有差异
+     * @param path 串口路径,通常为/dev/tty*开头
+     * @return 实际波特率, 小于0时为失败的-errno
+     */
+    external fun getBaudRate(path: String): Int
+
     /**
      * 打开一个读串口,用于监听数据
      * @param path 串口路径,通常为/dev/tty*开头
-     * @param baudrate 串口拨特率,底层在打开串口时会检测一次默认波特率
+     * @param baudrate 串口拨特率,支持任意正整数(如250000), 非标准值底层通过termios2设置
      * @param listener 读数据监听,为空的话就为只写接口
+     * @param decoder 帧解码器, 为空时按数据间隔分帧(见[setReadTimeInterval]), 参数非法时不会打开串口
+     */
+    external fun openSerialPort(path: String, baudrate: Int, listener: OnReadListener? = null, decoder: FrameDecoder? = null)
+
+    /**
+     * 并行打开多个串口, 开机时需要打开大量串口时使用, 总耗时约等于最慢的一个
+     * 已经打开或打开失败的串口会被跳过
+     * @param paths 串口路径,通常为/dev/tty*开头
+     * @param baudrates 与paths一一对应的波特率
+     * @param listeners 与paths一一对应的读数据监听, 为空的项只写
+     * @return 成功打开的串口数
+     */
+    external fun openSerialPorts(paths: Array<String>, baudrates: IntArray, listeners: Array<OnReadListener?>? = null): Int
+
+    /**
+     * 打开一个读串口,数据通过复用的DirectByteBuffer回调, 稳定运行时不会在java堆上分配内存, 适合持续扫码等高频场景
+     * @param path 串口路径,通常为/dev/tty*开头
+     * @param baudrate 串口拨特率
+     * @param listener 读数据监听
+     * @param decoder 帧解码器, 为空时按数据间隔分帧
      */
-    external fun openSerialPort(path: String, baudrate: Int, listener: OnReadListener? = null)
+    external fun openSerialPortDirect(path: String, baudrate: Int, listener: OnDirectReadListener, decoder: FrameDecoder? = null)
+
+    /**
+     * 打开一个读串口,多帧合并后一次性回调, 适合每秒上千帧的高频小帧设备
+     * 默认最多合并32帧或等待5000微秒, 可通过[setBatchDelivery]调整
+     * @param path 串口路径,通常为/dev/tty*开头
+     * @param baudrate 串口拨特率
+     * @param listener 读数据监听
+     * @param decoder 帧解码器, 为空时按数据间隔分帧
+     */
+    external fun openSerialPortBatched(path: String, baudrate: Int, listener: OnBatchReadListener, decoder: FrameDecoder? = null)
+
+    /**
+     * 设置合并回调的条件, 满足任意一个即回调, 从下一批开始生效
+     * @param path 串口路径,通常为/dev/tty*开头
+     * @param maxFrames 一次回调最多包含的帧数
+     * @param maxDelayUs 第一帧到达后最多等待的时间,单位为微秒, 为0时不等待
+     */
+    external fun setBatchDelivery(path: String, maxFrames: Int, maxDelayUs: Int)
+
+    /**
+     * 开启后新打开的串口共用底层一个epoll线程读写, 不再每个串口单独开启读写线程, 适合串口较多的设备
+     * 注意: 回调在共用线程执行, 不要在回调中做耗时操作
+     * @param enabled 是否开启, 只影响之后打开的串口
+     */
+    external fun setReactorMode(enabled: Boolean)
+
+    /**
+     * 开始抓包, 在底层记录串口收发的每个字节及其时间戳, 不经过java层, 不影响收发性能;
+     * 来不及写入的数据会丢弃并在文件中记录丢弃条数, 不会阻塞收发. 已在抓包时先停止再重新开始
+     * 文件为预分配并内存映射的capture_<开始时间>_<序号>.mspcap, 写满后换下一个文件, 格式见CaptureLog.h
+     * @param dir 存放抓包文件的目录, 需要可写
+     * @param segmentBytes 单个文件大小, 最小65536
+     * @param maxSegments 本次抓包最多保留的文件数, 超出时删除最旧的文件
+     * @param path 只抓取该串口, 为空时抓取所有串口, 包括之后打开的串口
+     * @return 0表示成功, 否则为-errno
+     */
+    external fun startCapture(dir: String, segmentBytes: Int = 16 * 1024 * 1024, maxSegments: Int = 8, path: String? = null): Int
+
+    /**
+     * 停止抓包, 写完已缓存的数据后关闭文件
+     */
+    external fun stopCapture()
+
+    /**
+     * 底层帧解码器, 在读线程上从接收缓冲区中切出完整的帧, 只有完整的帧才会回调上层
+     * 使用解码器的串口不再按数据间隔分帧, 解析失败的数据会被丢弃并计入[PortStats.droppedFrames]
+     * 单帧最长64KB, 超过仍未解出完整帧时缓冲区中的数据会被整体丢弃
+     */
+    class FrameDecoder private constructor(
+        @JvmField val type: Int,
+        @JvmField val params: IntArray,
+        @JvmField val delimiter: ByteArray,
+        @JvmField val checksum: FrameChecksum? = null
+    ) {
+        /**
+         * 在底层校验每一帧末尾的校验码, 校验失败的帧直接丢弃, 不会回调上层
+         * COBS和SLIP校验的是解码后的数据
+         */
+        fun withChecksum(checksum: FrameChecksum) = FrameDecoder(type, params, delimiter, checksum)
+
+        companion object {
+            /**
+             * 固定长度的帧
+             * @param length 每帧的字节数
+             */
+            fun fixedLength(length: Int) = FrameDecoder(1, intArrayOf(length), ByteArray(0))
+
+            /**
+             * 帧头中带长度字段的帧, 帧长度 = offset + width + 长度字段的值 + adjustment
+             * 长度不合理时逐字节跳过重新同步
+             * @param offset 长度字段在帧中的位置
+             * @param width 长度字段的字节数, 只支持1, 2, 4
+             * @param bigEndian 长度字段是否为大端
+             * @param adjustment 长度字段之后还有多少字节不计入长度(如校验和), 长度字段包含帧头时为负数
+             */
+            fun lengthField(offset: Int, width: Int, bigEndian: Boolean = true, adjustment: Int = 0) =
+                FrameDecoder(2, intArrayOf(offset, width, if (bigEndian) 1 else 0, adjustment), ByteArray(0))
+
+            /**
+             * 以分隔符结尾的帧, 回调的数据不含分隔符, 连续的分隔符之间的空帧会被忽略
+             * @param delimiter 分隔符, 如"\r\n".toByteArray()
+             */
+            fun delimiter(delimiter: ByteArray) = FrameDecoder(3, IntArray(0), delimiter.copyOf())
+
+            /**
+             * COBS编码的帧, 以0x00结尾, 回调的是解码后的数据
+             */
+            fun cobs() = FrameDecoder(4, IntArray(0), ByteArray(0))
+
+            /**
+             * SLIP(RFC 1055)编码的帧, 以0xC0结尾, 回调的是去除转义后的数据
+             */
+            fun slip() = FrameDecoder(5, IntArray(0), ByteArray(0))
+        }
+    }
+
+    /**
+     * 帧末尾的校验码, 校验码本身仍是帧的一部分
+     * @param type 校验算法, 见CHECKSUM_*
+     * @param skip 开头不参与校验的字节数, 如帧头
+     * @param bigEndian 校验码是否高字节在前
+     */
+    class FrameChecksum(
+        @JvmField val type: Int,
+        @JvmField val skip: Int = 0,
+        @JvmField val bigEndian: Boolean = false
+    )
+
+    /**
+     * Modbus读请求
+     * @param slave 从站地址, 1-247
+     * @param function 功能码, 见MODBUS_READ_*
+     * @param address 起始地址, 0-65535
+     * @param count 寄存器数量(1-125), 或线圈/离散输入数量(1-2000)
+     */
+    data class ModbusRead(val slave: Int, val function: Int, val address: Int, val count: Int)
+
+    /**
+     * 延迟分布, 单位均为纳秒, 百分位数误差在12.5%以内
+     * @param count 样本数
+     * @param sum 样本总和, 除以count即为平均值
+     */
+    data class LatencyStats(
+        val count: Long,
+        val sum: Long,
+        val max: Long,
+        val p50: Long,
+        val p90: Long,
+        val p99: Long,
+        val p999: Long
+    )
+
+    /**
+     * 单个串口打开以来的统计
+     * @param bytesIn 读到的字节数
+     * @param bytesOut 写入驱动的字节数
+     * @param framesIn 回调给上层的帧数(含事务应答)
+     * @param framesOut 写完的消息数
+     * @param readCalls read系统调用次数
+     * @param writeCalls write系统调用次数
+     * @param shortWrites 驱动只接收了部分数据的写入次数
+     * @param queueHighWater 发送队列最多同时排队的消息数
+     * @param droppedFrames 没有监听而丢弃的帧, 超时作废的应答数据, 以及发送失败或被队列丢弃的消息数
+     * @param reconfigurations 运行中修改设置的次数
+     * @param queueRejections 发送队列满时被拒绝或丢弃的消息数
+     * @param queueCoalesced 被同一key的新消息替换的消息数([WRITE_LATEST]或[QUEUE_COALESCE])
+     * @param queueWait 消息从排队到写入驱动的时间
+     * @param syscallTime read/write系统调用耗时
+     * @param callbackTime 上层回调耗时
+     */
+    data class PortStats(
+        val bytesIn: Long,
+        val bytesOut: Long,
+        val framesIn: Long,
+        val framesOut: Long,
+        val readCalls: Long,
+        val writeCalls: Long,
+        val shortWrites: Long,
+        val queueHighWater: Long,
+        val droppedFrames: Long,
+        val reconfigurations: Long,
+        val queueRejections: Long,
+        val queueCoalesced: Long,
+        val queueWait: LatencyStats,
+        val syscallTime: LatencyStats,
+        val callbackTime: LatencyStats
+    )
+
+    interface OnWriteCompleteListener {
+        /**
+         * 在底层写线程回调, 不要做耗时操作
+         * @param sequence 该串口带[WRITE_DRAIN_AFTER]的消息按排队顺序从1开始的编号, [flush]也占用一个编号,
+         * 带[WRITE_PRIORITY]的消息可能先于编号更小的消息完成
+         * @param error 0表示已发送完毕, 否则为发送失败的errno
+         */
+        fun onWriteComplete(sequence: Long, error: Int)
+    }
+
+    interface OnTransactionListener {
+        /**
+         * @param id [transact]返回的事务编号
+         * @param status 0表示成功, -110为超时(ETIMEDOUT), -125为串口关闭取消(ECANCELED),
+         * -11为写队列已满未能发送(EAGAIN), 其他负值为发送失败的-errno
+         * @param response 应答数据, 失败时为空
+         */
+        fun onTransactionComplete(id: Long, status: Int, response: ByteArray?)
+    }
+
+    interface OnModbusPollListener {
+        /**
+         * 数组由底层复用, 只在回调期间有效, 需要保留数据请自行拷贝
+         * @param cycle 从1开始的周期编号
+         * @param status 每个请求的结果: 0为成功, 大于0为从站返回的异常码, -74为应答损坏或CRC错误(EBADMSG),
+         * -110为超时(ETIMEDOUT), -125为串口关闭取消(ECANCELED), -11为写队列已满本周期未发送(EAGAIN)
+         * @param offsets 第i个请求的结果为values中[offsets[i], offsets[i + 1])的数据
+         * @param values 寄存器值为无符号16位, 使用时toInt() and 0xFFFF; 线圈和离散输入为0或1; 失败的请求为0
+         */
+        fun onPollCycle(cycle: Long, status: IntArray, offsets: IntArray, values: ShortArray)
+    }
 
     interface OnReadListener {
         fun onDataReceived(msg: ByteArray)
     }
+
+    /**
+     * 带接收时间戳的[OnReadListener], 时间戳均为[receiveClockNanos]时钟的纳秒值,
+     * 在底层read返回后立即获取, 不受回调线程调度延迟影响, 可用于多个串口之间的排序
+     */
+    interface OnTimedReadListener : OnReadListener {
+        /**
+         * @param firstReadNs 读到本帧第一个字节的那次read返回的时间
+         * @param lastReadNs 读到本帧最后一个字节的那次read返回的时间
+         * @param firstByteNs 估算的第一个字节到达串口的时间, 未开启[setFirstByteEstimate]时为0
+         */
+        fun onDataReceived(msg: ByteArray, firstReadNs: Long, lastReadNs: Long, firstByteNs: Long)
+
+        override fun onDataReceived(msg: ByteArray) {}
+    }
+
+    interface OnDirectReadListener {
+        /**
+         * buffer由底层复用, 只在回调期间有效, 需要保留数据请自行拷贝
+         * @param buffer 指向底层接收缓冲区, 不要修改其中的内容, 也不要依赖position和limit
+         * @param offset 本帧数据在buffer中的起始位置
+         * @param length 本帧数据长度
+         */
+        fun onDataReceived(buffer: ByteBuffer, offset: Int, length: Int)
+    }
+
+    /**
+     * 带接收时间戳的[OnDirectReadListener], 时间戳含义见[OnTimedReadListener]
+     */
+    interface OnTimedDirectReadListener : OnDirectReadListener {
+        fun onDataReceived(buffer: ByteBuffer, offset: Int, length: Int,
+                           firstReadNs: Long, lastReadNs: Long, firstByteNs: Long)
+
+        override fun onDataReceived(buffer: ByteBuffer, offset: Int, length: Int) {}
+    }
+
+    interface OnBatchReadListener {
+        /**
+         * buffer和offsets由底层复用, 只在回调期间有效
+         * @param buffer 本批次所有帧的数据
+         * @param offsets 第i帧为buffer中[offsets[i], offsets[i + 1])的数据, 数组长度可能大于count + 1
+         * @param count 本批次帧数
+         */
+        fun onFramesReceived(buffer: ByteBuffer, offsets: IntArray, count: Int)
+    }
+
+    /**
+     * 带接收时间戳的[OnBatchReadListener]
+     */
+    interface OnTimedBatchReadListener : OnBatchReadListener {
+        /**
+         * @param timestamps 由底层复用, 第i帧的firstReadNs, lastReadNs, firstByteNs依次在[3 * i, 3 * i + 3),
+         * 含义见[OnTimedReadListener]
+         */
+        fun onFramesReceived(buffer: ByteBuffer, offsets: IntArray, count: Int, timestamps: LongArray)
+
+        override fun onFramesReceived(buffer: ByteBuffer, offsets: IntArray, count: Int) {}
+    }
 }
\ No newline at end of file
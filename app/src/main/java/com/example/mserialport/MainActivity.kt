@@ -98,10 +98,18 @@ class MainActivity : AppCompatActivity() {
                 val millis = System.currentTimeMillis()
                 val version = Random(millis).nextInt(2000)
                 val pageCmd = pageCmd("2900", "${version}${version}")
-                SerialPortManager.sendMessage(
+                //屏幕跟不上时只发送最新的时间和页面内容, 不再排队发送过期的
+                SerialPortManager.sendKeyedMessage(
                     mScreenPath,
-                    arrayOf(dateCommand, pageCmd),
-                    SerialPortManager.FLAG_WRITE
+                    0x0010,
+                    dateCommand,
+                    SerialPortManager.FLAG_WRITE or SerialPortManager.WRITE_LATEST
+                )
+                SerialPortManager.sendKeyedMessage(
+                    mScreenPath,
+                    0x2900,
+                    pageCmd,
+                    SerialPortManager.FLAG_WRITE or SerialPortManager.WRITE_LATEST
                 )
                 isOffline = !isOffline;
                 if (isOffline) {